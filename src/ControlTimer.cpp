@@ -0,0 +1,32 @@
+#include <Arduino.h>
+
+#include "ControlTimer.h"
+
+#ifdef ARDUINO_AVR_UNO
+static void (*tickCallback)() = nullptr; //!< Function to call on every tick
+
+ISR(TIMER1_COMPA_vect) {
+	tickCallback();
+}
+
+void ControlTimer::begin(void (*callback)()) {
+	tickCallback = callback;
+
+	// Timer1 in CTC mode with a prescaler of 64: compare match every interval
+	noInterrupts();
+	TCCR1A = 0;
+	TCCR1B = (1 << WGM12) | (1 << CS11) | (1 << CS10);
+	TCNT1 = 0;
+	OCR1A = F_CPU / 64 * interval / 1000000 - 1;
+	TIMSK1 |= (1 << OCIE1A);
+	interrupts();
+}
+#endif
+
+#if defined(ARDUINO_TEENSYLC) || defined(ARDUINO_TEENSY40)
+static IntervalTimer intervalTimer;
+
+void ControlTimer::begin(void (*callback)()) {
+	intervalTimer.begin(callback, interval);
+}
+#endif
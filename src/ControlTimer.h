@@ -0,0 +1,18 @@
+#ifndef HUMIDISTAT_CONTROLTIMER_H
+#define HUMIDISTAT_CONTROLTIMER_H
+
+#include <stdint.h>
+
+/// Hardware timer that calls a function at a fixed interval, from interrupt context.
+/// Uses an IntervalTimer on Teensy, and Timer1 (in CTC mode) on AVR.
+/// The callback should be short (well below the interval), and should not use Serial or the display.
+class ControlTimer {
+public:
+	static constexpr uint16_t interval = 1000; //!< Tick interval (in micros)
+
+	/// Start the timer.
+	/// \param callback Function to call on every tick
+	static void begin(void (*callback)());
+};
+
+#endif //HUMIDISTAT_CONTROLTIMER_H
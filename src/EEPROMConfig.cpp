@@ -3,23 +3,45 @@
 #include "EEPROMConfig.h"
 
 bool EEPROMConfig::load() {
-	EEPROM.readBlock(address, configStore);
+	bool valid = true;
+	for (uint8_t i = 0; i < config::nChannels; i++)
+		valid &= load(i);
+	return valid;
+}
+
+bool EEPROMConfig::load(uint8_t channel) {
+	ConfigStore &cs = configStores[channel];
+
+	// Start from the defaults, for the part that is not stored
+	cs = defaultConfigStore;
+	EEPROM.readBlock(address + channel * size, reinterpret_cast<uint8_t *>(&cs), size);
 
 	// Check whether loaded data is valid and if overrideEEPROM is not set
-	if(strcmp(configStore.version, defaultConfigStore.version) == 0 && !config::overrideEEPROM) {
+	if(strcmp(cs.version, defaultConfigStore.version) == 0 && !config::overrideEEPROM) {
+		// The gain schedule and valve tables may not have been stored before (if they were just enabled)
+		if (!cs.HC_gainSchedule.isSorted())
+			cs.HC_gainSchedule = defaultConfigStore.HC_gainSchedule;
+		for (uint8_t i = 0; i < 2; i++) {
+			if (!cs.S_valveTables[i].isValid())
+				cs.S_valveTables[i] = defaultConfigStore.S_valveTables[i];
+		}
+
 		// Set loadedFromEEPROM flag
-		configStore.loadedFromEEPROM = true;
+		cs.loadedFromEEPROM = true;
 		return true;
 	} else {
 		// Reset to defaults
-		reset();
-		save();
+		cs = defaultConfigStore;
+		EEPROM.updateBlock(address + channel * size, reinterpret_cast<const uint8_t *>(&cs), size);
 		return false;
 	}
 }
 
 uint16_t EEPROMConfig::save() const {
-	return EEPROM.updateBlock(address, configStore);
+	uint16_t n = 0;
+	for (uint8_t i = 0; i < config::nChannels; i++)
+		n += EEPROM.updateBlock(address + i * size, reinterpret_cast<const uint8_t *>(&configStores[i]), size);
+	return n;
 }
 
 EEPROMConfig::EEPROMConfig() {
@@ -27,5 +49,6 @@ EEPROMConfig::EEPROMConfig() {
 }
 
 void EEPROMConfig::reset() {
-	configStore = defaultConfigStore;
+	for (auto &cs : configStores)
+		cs = defaultConfigStore;
 }
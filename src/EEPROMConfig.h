@@ -1,6 +1,8 @@
 #ifndef HUMIDISTAT_EEPROMCONFIG_H
 #define HUMIDISTAT_EEPROMCONFIG_H
 
+#include <stddef.h>
+
 #include CONFIG_HEADER
 
 /// Config store containing variables, which can be stored in EEPROM.
@@ -18,6 +20,13 @@ struct ConfigStore {
 	double HC_Kf;
 	///@}
 
+	///@{
+	/// Humidity controller process model (for the Smith predictor)
+	double HC_modelK;
+	double HC_modelTau;
+	double HC_modelL;
+	///@}
+
 	///@{
 	/// Flow controller PID parameters
 	double FC_Kp;
@@ -27,16 +36,39 @@ struct ConfigStore {
 	uint16_t FC_dt;
 	///@}
 
+	///@{
+	/// Setpoint weights for the proportional and derivative terms (in percent). These are stored as integers in order
+	/// to fit in the padding before the next double (the EEPROM of the Teensy LC is full).
+	uint8_t HC_b;
+	uint8_t HC_c;
+	uint8_t FC_b;
+	uint8_t FC_c;
+	///@}
+
+	///@{
+	/// Setpoint ramp rate (in %RH/min) and acceleration (in %RH/min per s) limits, or 0 for none. These are stored as
+	/// integers in order to fit in the padding before the next double.
+	uint8_t SP_rampRate;
+	uint8_t SP_rampAccel;
+	///@}
+
 	/// Minimum solenoid duty cycle (deadband)
 	double S_lowValue;
 
 	/// Total flowrate (for cascade controller) (L/min)
 	double HC_totalFlowrate;
 
-	/// Smoothing factor of EMA filter for derivative
-	double a;
+	/// Time constant of the derivative filter of the humidity controller (in s)
+	double HC_Tf;
+
+	/// Linearisation tables of the solenoid valves. Only stored in EEPROM if valveLinearization (or gainScheduling) is
+	/// enabled.
+	ValveTable<config::VT_nPoints> S_valveTables[2];
+
+	/// Humidity controller gain schedule. Keep this last: it is only stored in EEPROM if gainScheduling is enabled.
+	GainSchedule<config::GS_nPoints> HC_gainSchedule;
 } const defaultConfigStore = {
-	"hum2",
+	"hum8",
 	false,
 	config::dt,
 
@@ -45,39 +77,72 @@ struct ConfigStore {
 	config::HC_Kd,
 	config::HC_Kf,
 
+	config::HC_modelK,
+	config::HC_modelTau,
+	config::HC_modelL,
+
 	config::FC_Kp,
 	config::FC_Ki,
 	config::FC_Kd,
 	config::FC_Kf,
 	config::FC_dt,
 
+	config::HC_b,
+	config::HC_c,
+	config::FC_b,
+	config::FC_c,
+
+	config::SP_rampRate,
+	config::SP_rampAccel,
+
 	config::S_lowValue,
 	config::HC_totalFlowrate,
-	config::a,
+	config::HC_Tf,
+
+	{config::S_valveTables[0], config::S_valveTables[1]},
+
+	config::HC_gainSchedule,
 };
 
-/// Load/save an (internal) ConfigStore in EEPROM.
+/// Load/save the (internal) ConfigStores, one for each channel, in EEPROM.
 class EEPROMConfig {
 private:
-	uint8_t address = config::EEPROMAddress;
+	uint16_t address = config::EEPROMAddress;
+
+	/// Load the config values of a single channel from EEPROM.
+	/// \param channel Channel
+	/// \return 1 if valid data was read, 0 if not
+	bool load(uint8_t channel);
 
 public:
-	ConfigStore configStore;
+	/// Number of bytes of the configStore that are stored in EEPROM. The valve tables and the gain schedule are only
+	/// stored if they are used, in order not to use up EEPROM space otherwise.
+	static constexpr uint16_t size = config::gainScheduling     ? sizeof(ConfigStore)
+	                               : config::valveLinearization ? offsetof(ConfigStore, HC_gainSchedule)
+	                                                            : offsetof(ConfigStore, S_valveTables);
+
+	ConfigStore configStores[config::nChannels]; //!< Config store for each channel
+	ConfigStore &configStore = configStores[0];   //!< Config store of the first channel
 
 	/// Constructor.
 	EEPROMConfig();
 
-	/// Load config values from EEPROM into configStore.
-	/// \return 1 if valid data was read, 0 if not
+	/// Load config values from EEPROM into the configStores.
+	/// \return 1 if valid data was read for all channels, 0 if not
 	bool load();
 
-	/// Saves current content of configStore into EEPROM.
+	/// Saves current content of the configStores into EEPROM.
 	/// \return number of bytes written
 	uint16_t save() const;
 
-	/// Reset the config store: overwrite the configStore with the default values.
+	/// Reset the config stores: overwrite the configStores with the default values.
 	void reset();
 };
 
 
+#ifdef E2END
+static_assert(config::EEPROMAddress + config::nChannels * EEPROMConfig::size <= E2END + 1,
+              "ConfigStore does not fit in EEPROM");
+#endif
+
 #endif //HUMIDISTAT_EEPROMCONFIG_H
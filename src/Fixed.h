@@ -0,0 +1,205 @@
+#ifndef HUMIDISTAT_FIXED_H
+#define HUMIDISTAT_FIXED_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/// Layout of an IEEE 754 floating-point number of the given size (binary32 or binary64).
+/// \tparam size Size (in bytes)
+template<uint8_t size>
+struct FloatFormat;
+
+template<>
+struct FloatFormat<4> {
+	using Bits = uint32_t;
+	static constexpr uint8_t mantBits = 23;
+	static constexpr int16_t expMax = 0xFF;
+	static constexpr int16_t bias = 127;
+};
+
+template<>
+struct FloatFormat<8> {
+	using Bits = uint64_t;
+	static constexpr uint8_t mantBits = 52;
+	static constexpr int16_t expMax = 0x7FF;
+	static constexpr int16_t bias = 1023;
+};
+
+/// Signed fixed-point number, stored in an int32_t with F fractional bits (Q(31-F).F format).
+/// Conversions from and to double are explicit, in order to keep floating-point arithmetic from sneaking in.
+/// Arithmetic saturates instead of wrapping around on overflow.
+/// Products of two fixed-point numbers of different formats take the format of the left-hand side operand.
+/// \tparam F Number of fractional bits
+template<uint8_t F>
+class Fixed {
+private:
+	int32_t raw; //!< Underlying integer representation
+
+	static constexpr int32_t rawMax = 0x7FFFFFFF;  //!< Largest representable underlying integer
+	static constexpr int32_t rawMin = -rawMax - 1; //!< Smallest representable underlying integer
+
+	/// Clamp a 64-bit intermediate result to the range of the underlying integer.
+	/// \param value Value to clamp
+	/// \return Clamped value
+	static constexpr int32_t saturate(int64_t value) {
+		if (value > rawMax)
+			return rawMax;
+		if (value < rawMin)
+			return rawMin;
+		return static_cast<int32_t>(value);
+	}
+
+	/// Convert the underlying integer of a fixed-point number with G fractional bits to one with F fractional bits.
+	/// \tparam G Number of fractional bits of the source
+	/// \param value Underlying integer of the source
+	/// \return Underlying integer in this format
+	template<uint8_t G>
+	static constexpr int32_t convert(int32_t value) {
+		if constexpr (G > F)
+			return value >> (G - F);
+		else
+			return saturate(static_cast<int64_t>(value) << (F - G));
+	}
+
+public:
+	static constexpr uint8_t fracBits = F;
+
+	constexpr Fixed() : raw(0) {}
+
+	/// Construct from a double (rounded to nearest).
+	/// \param value Value
+	constexpr explicit Fixed(double value)
+		: raw(saturate(static_cast<int64_t>(value * (static_cast<int64_t>(1) << F) + (value < 0 ? -0.5 : 0.5)))) {}
+
+	/// Construct from a fixed-point number in another format.
+	/// \param other Value
+	template<uint8_t G>
+	constexpr explicit Fixed(Fixed<G> other) : raw(convert<G>(other.getRaw())) {}
+
+	/// Construct from the underlying integer representation.
+	/// \param raw Underlying integer
+	/// \return Fixed-point number
+	static constexpr Fixed fromRaw(int32_t raw) {
+		Fixed f;
+		f.raw = raw;
+		return f;
+	}
+
+	/// Convert from a floating-point number at run time, rounded to nearest like the constructor, but using integer
+	/// arithmetic only: the mantissa is shifted by the exponent. On MCUs without an FPU, this avoids the soft-float
+	/// multiplication and the conversion to a 64-bit integer of the constructor. NaN is converted to 0.
+	/// \tparam Float float or double
+	/// \param value Value
+	/// \return Fixed-point number
+	template<typename Float>
+	static Fixed fromFloat(Float value) {
+		using Format = FloatFormat<sizeof(Float)>;
+		using Bits = typename Format::Bits;
+		constexpr Bits mantMask = (static_cast<Bits>(1) << Format::mantBits) - 1;
+
+		Bits bits;
+		memcpy(&bits, &value, sizeof(bits));
+		bool negative = bits >> (8 * sizeof(Bits) - 1);
+		int16_t exponent = static_cast<int16_t>((bits >> Format::mantBits) & Format::expMax);
+
+		// Zero and subnormals are far below the resolution
+		if (exponent == 0)
+			return Fixed();
+		if (exponent == Format::expMax)
+			return (bits & mantMask) ? Fixed() : fromRaw(negative ? rawMin : rawMax);
+
+		// The value is mantissa * 2^(exponent - bias - mantBits), so raw is mantissa * 2^shift
+		Bits mantissa = (bits & mantMask) | (static_cast<Bits>(1) << Format::mantBits);
+		int16_t shift = exponent - Format::bias - Format::mantBits + F;
+		Bits magnitude;
+		if (shift >= 0) {
+			if (shift + Format::mantBits >= 31)
+				return fromRaw(negative ? rawMin : rawMax);
+			magnitude = mantissa << shift;
+		} else {
+			// Below 1/2 (in units of the resolution), the value rounds to 0
+			if (-shift >= Format::mantBits + 2)
+				return Fixed();
+			magnitude = (mantissa + (static_cast<Bits>(1) << (-shift - 1))) >> -shift;
+		}
+
+		if (magnitude > static_cast<Bits>(rawMax))
+			return fromRaw(negative ? rawMin : rawMax);
+		return fromRaw(negative ? -static_cast<int32_t>(magnitude) : static_cast<int32_t>(magnitude));
+	}
+
+	/// Convert to a floating-point number at run time. Equal to the conversion operator, but scales by adjusting the
+	/// exponent instead of by a (soft-float) multiplication.
+	/// \tparam Float float or double
+	/// \return Value
+	template<typename Float>
+	Float toFloat() const {
+		return ldexp(static_cast<Float>(raw), -F);
+	}
+
+	/// Get the underlying integer representation.
+	/// \return Underlying integer
+	constexpr int32_t getRaw() const {
+		return raw;
+	}
+
+	constexpr explicit operator double() const {
+		return raw * (1.0 / (static_cast<int64_t>(1) << F));
+	}
+
+	constexpr Fixed operator-() const {
+		return fromRaw(saturate(-static_cast<int64_t>(raw)));
+	}
+
+	constexpr Fixed operator+(Fixed other) const {
+		return fromRaw(saturate(static_cast<int64_t>(raw) + other.raw));
+	}
+
+	constexpr Fixed operator-(Fixed other) const {
+		return fromRaw(saturate(static_cast<int64_t>(raw) - other.raw));
+	}
+
+	template<uint8_t G>
+	constexpr Fixed operator*(Fixed<G> other) const {
+		return fromRaw(saturate((static_cast<int64_t>(raw) * other.getRaw()) >> G));
+	}
+
+	constexpr Fixed operator/(int32_t divisor) const {
+		return fromRaw(raw / divisor);
+	}
+
+	constexpr Fixed &operator+=(Fixed other) {
+		return *this = *this + other;
+	}
+
+	constexpr Fixed &operator-=(Fixed other) {
+		return *this = *this - other;
+	}
+
+	constexpr bool operator==(Fixed other) const { return raw == other.raw; }
+	constexpr bool operator!=(Fixed other) const { return raw != other.raw; }
+	constexpr bool operator<(Fixed other) const { return raw < other.raw; }
+	constexpr bool operator>(Fixed other) const { return raw > other.raw; }
+	constexpr bool operator<=(Fixed other) const { return raw <= other.raw; }
+	constexpr bool operator>=(Fixed other) const { return raw >= other.raw; }
+};
+
+/// Conversion from and to double at run time, for code that is templated on its arithmetic type (double or Fixed).
+/// \tparam T Arithmetic type
+template<typename T>
+struct ScalarCast {
+	static T from(double value) { return T(value); }
+	static double to(T value) { return static_cast<double>(value); }
+};
+
+template<uint8_t F>
+struct ScalarCast<Fixed<F>> {
+	static Fixed<F> from(double value) { return Fixed<F>::fromFloat(value); }
+	static double to(Fixed<F> value) { return value.template toFloat<double>(); }
+};
+
+using q16_16 = Fixed<16>; //!< Range of +-32768 with a resolution of 1.5e-5
+using q8_24 = Fixed<24>;  //!< Range of +-128 with a resolution of 6.0e-8
+
+#endif //HUMIDISTAT_FIXED_H
@@ -0,0 +1,73 @@
+#ifndef HUMIDISTAT_GAINSCHEDULE_H
+#define HUMIDISTAT_GAINSCHEDULE_H
+
+#include <stdint.h>
+#include <math.h>
+
+/// Breakpoint of a gain schedule: a value of the scheduling variable, and the PID gains at that value.
+struct GainPoint {
+	double x;  //!< Value of the scheduling variable (relative humidity, in percent)
+	double Kp; //!< Proportional gain
+	double Ki; //!< Integral gain (in 1/s)
+	double Kd; //!< Derivative gain (in s)
+};
+
+/// Gain schedule: a table of breakpoints, sorted by x. In between breakpoints, the gains are interpolated linearly.
+/// Outside the table, the gains of the first/last breakpoint are used.
+/// \tparam N Number of breakpoints
+template<uint8_t N>
+struct GainSchedule {
+	GainPoint points[N];
+
+	/// Interpolate the gains at the given value of the scheduling variable.
+	/// \param x  Value of the scheduling variable
+	/// \param Kp Proportional gain
+	/// \param Ki Integral gain (in 1/s)
+	/// \param Kd Derivative gain (in s)
+	void interpolate(double x, double &Kp, double &Ki, double &Kd) const {
+		const GainPoint *p0 = &points[N - 1], *p1 = &points[N - 1];
+		double f = 0;
+
+		if (x <= points[0].x) {
+			p0 = p1 = &points[0];
+		} else {
+			// Find the segment containing x
+			for (uint8_t i = 1; i < N; ++i) {
+				if (x < points[i].x) {
+					p0 = &points[i - 1];
+					p1 = &points[i];
+					f = (x - p0->x) / (p1->x - p0->x);
+					break;
+				}
+			}
+		}
+
+		Kp = p0->Kp + f * (p1->Kp - p0->Kp);
+		Ki = p0->Ki + f * (p1->Ki - p0->Ki);
+		Kd = p0->Kd + f * (p1->Kd - p0->Kd);
+	}
+
+	/// Get the breakpoint nearest to the given value of the scheduling variable.
+	/// \param x Value of the scheduling variable
+	/// \return Reference to the breakpoint
+	GainPoint &nearest(double x) {
+		uint8_t nearest = 0;
+		for (uint8_t i = 1; i < N; ++i) {
+			if (fabs(points[i].x - x) < fabs(points[nearest].x - x))
+				nearest = i;
+		}
+		return points[nearest];
+	}
+
+	/// Check whether the breakpoints are sorted (strictly increasing in x, and not NaN).
+	/// \return True if sorted
+	constexpr bool isSorted() const {
+		for (uint8_t i = 1; i < N; ++i) {
+			if (!(points[i].x > points[i - 1].x))
+				return false;
+		}
+		return true;
+	}
+};
+
+#endif //HUMIDISTAT_GAINSCHEDULE_H
@@ -7,33 +7,74 @@
 #include "asprintf.h"
 #include "control/SingleHumidistat.h"
 #include "control/CascadeHumidistat.h"
-#include "sensor/ThermistorReader.h"
+#include "sensor/ThermistorBank.h"
 
-/// Logs humidistat data over serial.
+/// Logs humidistat data over serial. Each line contains the time, a block of columns for each channel, and the
+/// thermistor temperatures. With multiple channels, the column names are suffixed by the channel index (e.g. SP_1).
 /// \tparam Humidistat_t Either SingleHumidistat or CascadeHumidistat
 template<class Humidistat_t>
 class SerialLogger {
 private:
-	const Humidistat_t &humidistat;
-	const etl::span<const ThermistorReader, 4> trs;
+	const etl::span<const Humidistat_t> humidistats;
+	const ThermistorBank &thermistors;
 
 	// Can't specialize constexpr...
-	static const char header[];
+	static const char *const columns[]; //!< Names of the columns for a single channel
+	static const uint8_t nColumns;      //!< Number of columns for a single channel
 
 	const uint16_t interval;    //!< Logging interval (in millis)
 	unsigned long lastTime = 0; //!< Last time line was written (in millis)
 	bool ready = false;
 
+	void (*printStats)() = nullptr; //!< Function to call on the STATS command
+
+	/// Write the header line to serial
+	void printHeader() const {
+		Serial.print("Time");
+		for (size_t i = 0; i < humidistats.size(); i++) {
+			for (uint8_t j = 0; j < nColumns; j++) {
+				Serial.print(' ');
+				Serial.print(columns[j]);
+				if (humidistats.size() > 1) {
+					Serial.print('_');
+					Serial.print(i);
+				}
+			}
+		}
+		Serial.println(" T0 T1 T2 T3");
+	}
+
+	/// Write the columns of a single channel to serial (without leading or trailing whitespace)
+	/// \param humidistat Humidistat of the channel
+	void logChannel(const Humidistat_t &humidistat) const;
+
 	/// Write a line to serial
-	void log();
+	void log() const {
+		Serial.print(lastTime);
+		for (const Humidistat_t &humidistat : humidistats) {
+			Serial.print(' ');
+			logChannel(humidistat);
+		}
+
+		char *buf = asprintf(" %.2f %.2f %.2f %.2f",
+		                     thermistors.getTemp(0),
+		                     thermistors.getTemp(1),
+		                     thermistors.getTemp(2),
+		                     thermistors.getTemp(3)
+		);
+
+		Serial.println(buf);
+		delete buf;
+	}
 
 public:
 	/// Constructor.
-	/// \param humidistat Pointer to a Humidistat instance
-	/// \param trs        Span over 4 ThermistorReader instances
-	/// \param interval   Logging interval (in ms)
-	explicit SerialLogger(const Humidistat_t *humidistat, etl::span<const ThermistorReader, 4> trs, uint16_t interval)
-			: humidistat(*humidistat), trs(trs), interval(interval) {}
+	/// \param humidistats Span over the Humidistat instances (one for each channel)
+	/// \param thermistors Pointer to a ThermistorBank instance
+	/// \param interval    Logging interval (in ms)
+	explicit SerialLogger(etl::span<const Humidistat_t> humidistats, const ThermistorBank *thermistors,
+	                      uint16_t interval)
+			: humidistats(humidistats), thermistors(*thermistors), interval(interval) {}
 
 	/// Setup the serial interface
 	static void begin(uint32_t baud) {
@@ -42,9 +83,16 @@ public:
 		Serial.println("RDY");
 	}
 
+	/// Set the function to call on the STATS command. This function should print lines prefixed by '#', so they can be
+	/// told apart from the log stream.
+	/// \param printStats Function printing statistics to Serial
+	void setStatsPrinter(void (*printStats)()) {
+		this->printStats = printStats;
+	}
+
 	/// Log a line every interval, once data has been received
 	void update() {
-		// Listen for RDY signal
+		// Listen for RDY signal and commands
 		if (Serial.available()) {
 			char buf[8];
 			size_t numRead = Serial.readBytesUntil('\r', buf, 7);
@@ -52,8 +100,10 @@ public:
 
 			if (strcmp(buf, "RDY") == 0) {
 				// Print header and set ready state
-				Serial.println(header);
+				printHeader();
 				ready = true;
+			} else if (strcmp(buf, "STATS") == 0 && printStats != nullptr) {
+				printStats();
 			}
 		}
 
@@ -67,40 +117,52 @@ public:
 };
 
 template<>
-const char SerialLogger<SingleHumidistat>::header[] = "Time Humidity Setpoint Temperature ControlValue T0 T1 T2 T3 "
-													  "pTerm iTerm dTerm";
+const char *const SerialLogger<SingleHumidistat>::columns[] = {"Humidity", "Setpoint", "Temperature", "ControlValue",
+                                                               "pTerm", "iTerm", "dTerm", "Estimate", "Innovation",
+                                                               "NIS", "RampedSetpoint"};
+
+template<>
+const uint8_t SerialLogger<SingleHumidistat>::nColumns = sizeof(columns) / sizeof(columns[0]);
 
 template<>
-const char SerialLogger<CascadeHumidistat>::header[] = "Time PV SP T CV inner0PV inner0SP inner0CV inner1PV inner1SP "
-													   "inner1CV pTerm iTerm dTerm inner0pTerm inner0iTerm inner0dTerm "
-                                                       "inner1pTerm inner1iTerm inner1dTerm";
+const char *const SerialLogger<CascadeHumidistat>::columns[] = {"PV", "SP", "T", "CV", "inner0PV", "inner0SP",
+                                                                "inner0CV", "inner1PV", "inner1SP", "inner1CV",
+                                                                "pTerm", "iTerm", "dTerm", "inner0pTerm",
+                                                                "inner0iTerm", "inner0dTerm", "inner1pTerm",
+                                                                "inner1iTerm", "inner1dTerm", "PVest", "innov", "NIS",
+                                                                "SPramp"};
 
 template<>
-void SerialLogger<SingleHumidistat>::log() {
+const uint8_t SerialLogger<CascadeHumidistat>::nColumns = sizeof(columns) / sizeof(columns[0]);
+
+template<>
+void SerialLogger<SingleHumidistat>::logChannel(const SingleHumidistat &humidistat) const {
 	double pTerm, iTerm, dTerm;
 	humidistat.getTerms(pTerm, iTerm, dTerm);
 
-	char *buf = asprintf("%lu %.2f %.2f %.2f %.4f %.2f %.2f %.2f %.2f %.4f %.4f %.4f",
-	                     lastTime,
+	double innovation, nis;
+	humidistat.getInnovation(innovation, nis);
+
+	char *buf = asprintf("%.2f %.2f %.2f %.4f %.4f %.4f %.4f %.2f %.3f %.3f %.2f",
 	                     humidistat.getHumidity(),
 	                     humidistat.sp,
 	                     humidistat.getTemperature(),
 	                     humidistat.cv,
-	                     trs[0].readTemp(),
-	                     trs[1].readTemp(),
-	                     trs[2].readTemp(),
-	                     trs[3].readTemp(),
 	                     pTerm,
 	                     iTerm,
-	                     dTerm
+	                     dTerm,
+	                     humidistat.getEstimate(),
+	                     innovation,
+	                     nis,
+	                     humidistat.getRampedSetpoint()
 	);
 
-	Serial.println(buf);
+	Serial.print(buf);
 	delete buf;
 }
 
 template<>
-void SerialLogger<CascadeHumidistat>::log() {
+void SerialLogger<CascadeHumidistat>::logChannel(const CascadeHumidistat &humidistat) const {
 	double outerPTerm, outerITerm, outerDTerm;
 	humidistat.getTerms(outerPTerm, outerITerm, outerDTerm);
 
@@ -108,8 +170,11 @@ void SerialLogger<CascadeHumidistat>::log() {
 	humidistat.getInner(0)->getTerms(innerPTerms[0], innerITerms[0], innerDTerms[0]);
 	humidistat.getInner(1)->getTerms(innerPTerms[1], innerITerms[1], innerDTerms[1]);
 
-	char *buf = asprintf("%lu %.2f %.2f %.2f %.4f %.3f %.4f %.3f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f",
-	                     lastTime,
+	double innovation, nis;
+	humidistat.getInnovation(innovation, nis);
+
+	char *buf = asprintf("%.2f %.2f %.2f %.4f %.3f %.4f %.3f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f "
+	                     "%.2f %.3f %.3f %.2f",
 	                     humidistat.getHumidity(),
 	                     humidistat.sp,
 	                     humidistat.getTemperature(),
@@ -128,10 +193,14 @@ void SerialLogger<CascadeHumidistat>::log() {
 	                     innerDTerms[0],
 	                     innerPTerms[1],
 	                     innerITerms[1],
-	                     innerDTerms[1]
+	                     innerDTerms[1],
+	                     humidistat.getEstimate(),
+	                     innovation,
+	                     nis,
+	                     humidistat.getRampedSetpoint()
 	);
 
-	Serial.println(buf);
+	Serial.print(buf);
 	delete buf;
 }
 
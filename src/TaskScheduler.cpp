@@ -0,0 +1,41 @@
+#include <Arduino.h>
+
+#include "TaskScheduler.h"
+
+TaskScheduler::TaskScheduler(etl::span<Task> tasks) : tasks(tasks) {}
+
+void TaskScheduler::run() {
+	// Find the due task with the highest priority
+	Task *next = nullptr;
+	for (Task &task : tasks) {
+		if (millis() - task.lastRun < task.period)
+			continue;
+		if (next == nullptr || task.priority < next->priority)
+			next = &task;
+	}
+	if (next == nullptr)
+		return;
+
+	next->lastRun = millis();
+	uint32_t start = TimingStats::now();
+	next->run();
+	uint32_t runtime = TimingStats::now() - start;
+
+	next->stats.record(runtime);
+	if (TimingStats::toMicros(runtime) > next->budget)
+		next->overruns++;
+}
+
+etl::span<const Task> TaskScheduler::getTasks() const {
+	return tasks;
+}
+
+void TaskScheduler::printStats(Print &out) const {
+	for (const Task &task : tasks) {
+		out.print("# ");
+		out.print(task.name);
+		out.print(" overruns=");
+		out.println(task.overruns);
+		task.stats.print(out, task.name);
+	}
+}
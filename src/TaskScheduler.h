@@ -0,0 +1,57 @@
+#ifndef HUMIDISTAT_TASKSCHEDULER_H
+#define HUMIDISTAT_TASKSCHEDULER_H
+
+#include <stdint.h>
+#include <etl/span.h>
+#include <Print.h>
+
+#include "TimingStats.h"
+
+/// A periodic task, to be run by a TaskScheduler.
+struct Task {
+	const char *const name; //!< Name (for printing statistics)
+	void (*const run)();    //!< Function to run
+	const uint16_t period;  //!< Period (in millis, at least 1)
+	const uint8_t priority; //!< Priority (lower value takes precedence)
+	const uint16_t budget;  //!< Maximum runtime (in micros)
+
+	unsigned long lastRun = 0; //!< Last time the task was started (in millis)
+	uint16_t overruns = 0;     //!< Number of times the runtime exceeded the budget
+	TimingStats stats;         //!< Runtime statistics
+
+	/// Constructor.
+	/// \param name     Name (for printing statistics)
+	/// \param run      Function to run
+	/// \param period   Period (in millis, at least 1)
+	/// \param priority Priority (lower value takes precedence)
+	/// \param budget   Maximum runtime (in micros)
+	Task(const char *name, void (*run)(), uint16_t period, uint8_t priority, uint16_t budget)
+		: name(name), run(run), period(period), priority(priority), budget(budget) {}
+};
+
+/// Cooperative scheduler for periodic tasks in the main loop.
+/// Every call to run() runs (at most) one task: the due task with the highest priority. This way, a long-running task
+/// can delay, but not starve, higher-priority tasks: these run first on the next pass.
+/// Tasks run to completion; their runtime is recorded, and if a task exceeds its budget, this is counted as an overrun.
+class TaskScheduler {
+private:
+	const etl::span<Task> tasks;
+
+public:
+	/// Constructor.
+	/// \param tasks Span over the task table
+	explicit TaskScheduler(etl::span<Task> tasks);
+
+	/// Run the due task with the highest priority. Call this in the main loop.
+	void run();
+
+	/// Get the task table (for inspecting runtimes and overruns).
+	/// \return Span over the task table
+	[[nodiscard]] etl::span<const Task> getTasks() const;
+
+	/// Print the runtime statistics and number of overruns of all tasks, one line per task.
+	/// \param out Print instance to print to
+	void printStats(Print &out) const;
+};
+
+#endif //HUMIDISTAT_TASKSCHEDULER_H
@@ -0,0 +1,60 @@
+#include <Arduino.h>
+
+#include "TimingStats.h"
+
+uint32_t TimingStats::now() {
+#ifdef ARDUINO_TEENSY40
+	return ARM_DWT_CYCCNT;
+#else
+	return micros();
+#endif
+}
+
+uint32_t TimingStats::toMicros(uint32_t ticks) {
+#ifdef ARDUINO_TEENSY40
+	return ticks / (F_CPU_ACTUAL / 1000000);
+#else
+	return ticks;
+#endif
+}
+
+void TimingStats::record(uint32_t ticks) {
+	if (ticks < min)
+		min = ticks;
+	if (ticks > max)
+		max = ticks;
+	sum += ticks;
+	count++;
+
+	// Bucket index is the number of significant bits of the time in micros
+	uint32_t us = toMicros(ticks);
+	uint8_t i = 0;
+	while (us != 0 && i < nBuckets - 1) {
+		us >>= 1;
+		i++;
+	}
+	if (buckets[i] != 0xFFFF)
+		buckets[i]++;
+}
+
+void TimingStats::print(Print &out, const char *name) const {
+	out.print("# ");
+	out.print(name);
+	out.print(" n=");
+	out.print(count);
+	if (count != 0) {
+		out.print(" min=");
+		out.print(toMicros(min));
+		out.print(" mean=");
+		out.print(toMicros(sum / count));
+		out.print(" max=");
+		out.print(toMicros(max));
+	}
+	out.print(" hist=");
+	for (uint8_t i = 0; i < nBuckets; i++) {
+		if (i != 0)
+			out.print(',');
+		out.print(buckets[i]);
+	}
+	out.println();
+}
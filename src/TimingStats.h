@@ -0,0 +1,42 @@
+#ifndef HUMIDISTAT_TIMINGSTATS_H
+#define HUMIDISTAT_TIMINGSTATS_H
+
+#include <stdint.h>
+#include <Print.h>
+
+/// Execution time statistics: minimum, maximum, mean and a histogram with logarithmic (power-of-two) buckets.
+/// Times are measured with the DWT cycle counter on the Teensy 4.0, and with micros() otherwise.
+class TimingStats {
+private:
+	static constexpr uint8_t nBuckets = 16; //!< Number of histogram buckets
+
+	uint32_t min = 0xFFFFFFFF; //!< Shortest time (in ticks)
+	uint32_t max = 0;          //!< Longest time (in ticks)
+	uint64_t sum = 0;          //!< Sum of all times (in ticks)
+	uint32_t count = 0;        //!< Number of recorded times
+	/// Histogram: bucket 0 counts times below 1 us, bucket i times in [2^(i-1), 2^i) us, and the last bucket all
+	/// longer times. The counts saturate.
+	uint16_t buckets[nBuckets] = {};
+
+public:
+	/// Convert ticks to micros.
+	/// \param ticks Time (in ticks)
+	/// \return Time (in micros)
+	static uint32_t toMicros(uint32_t ticks);
+
+	/// Get the current time, for measuring a duration with record().
+	/// \return Current time (in ticks)
+	static uint32_t now();
+
+	/// Record a duration.
+	/// \param ticks Duration (in ticks), i.e. the difference between two calls to now()
+	void record(uint32_t ticks);
+
+	/// Print the statistics as a single line, prefixed with '#' to distinguish it from the log stream.
+	/// Times are printed in micros.
+	/// \param out  Print instance to print to
+	/// \param name Name of the measured subsystem
+	void print(Print &out, const char *name) const;
+};
+
+#endif //HUMIDISTAT_TIMINGSTATS_H
@@ -0,0 +1,52 @@
+#ifndef HUMIDISTAT_VALVETABLE_H
+#define HUMIDISTAT_VALVETABLE_H
+
+#include <stdint.h>
+
+/// Inverse lookup table linearising a solenoid valve: the duty cycles at which the flowrate through the valve is at
+/// evenly spaced fractions (0, 1/(N-1), ..., 1) of its maximum. In between, the duty cycle is interpolated linearly.
+/// The duty cycles are stored as integers (in 1/65535) to save EEPROM space, and must be non-decreasing.
+/// \tparam N Number of entries
+template<uint8_t N>
+struct ValveTable {
+	uint16_t duty[N]; //!< Duty cycle (in 1/65535) at flowrate fraction i/(N-1)
+
+	/// Make a table that maps flowrate fractions linearly onto [low, high]. This corresponds to the behaviour of the
+	/// valve without linearisation (with low = S_lowValue, high = 1).
+	/// \param low  Duty cycle at zero flowrate
+	/// \param high Duty cycle at maximum flowrate
+	/// \return Table
+	static constexpr ValveTable linear(double low, double high) {
+		ValveTable table{};
+		for (uint8_t i = 0; i < N; ++i)
+			table.duty[i] = static_cast<uint16_t>((low + (high - low) * i / (N - 1)) * 65535 + 0.5);
+		return table;
+	}
+
+	/// Look up the duty cycle for the given flowrate fraction.
+	/// \param fraction Flowrate fraction (0-1)
+	/// \return Duty cycle (0-1)
+	double lookup(double fraction) const {
+		if (!(fraction > 0))
+			return duty[0] / 65535.;
+		if (fraction >= 1)
+			return duty[N - 1] / 65535.;
+
+		double x = fraction * (N - 1);
+		uint8_t i = static_cast<uint8_t>(x);
+		double f = x - i;
+		return (duty[i] + f * (duty[i + 1] - duty[i])) / 65535.;
+	}
+
+	/// Check whether the table is valid: monotone (non-decreasing), and not constant.
+	/// \return True if valid
+	constexpr bool isValid() const {
+		for (uint8_t i = 1; i < N; ++i) {
+			if (duty[i] < duty[i - 1])
+				return false;
+		}
+		return duty[N - 1] > duty[0];
+	}
+};
+
+#endif //HUMIDISTAT_VALVETABLE_H
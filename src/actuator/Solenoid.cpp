@@ -0,0 +1,73 @@
+#include <Arduino.h>
+
+#include "Solenoid.h"
+
+Solenoid::Solenoid(uint8_t pin, uint8_t pwmRes, const ValveTable<config::VT_nPoints> *table)
+		: pin(pin), range(1UL << pwmRes), table(table) {}
+
+void Solenoid::write(double cv) {
+	convert(cv, table != nullptr);
+	output();
+}
+
+void Solenoid::writeRaw(double duty) {
+	convert(duty, false);
+	output();
+}
+
+void Solenoid::convert(double input, bool linearised) {
+	if (input == this->input && linearised == this->linearised)
+		return;
+	this->input = input;
+	this->linearised = linearised;
+
+	duty = scale(linearised ? table->lookup(input) : input);
+}
+
+uint32_t Solenoid::toDuty(double cv) const {
+	return scale(table != nullptr ? table->lookup(cv) : cv);
+}
+
+uint32_t Solenoid::scale(double duty) const {
+	if (duty < 0)
+		duty = 0;
+	if (duty > 1)
+		duty = 1;
+	return static_cast<uint32_t>(duty * range * 256);
+}
+
+void Solenoid::writeDuty(uint32_t duty) {
+	this->duty = duty;
+	output();
+}
+
+void Solenoid::output() {
+	if (!config::PWM_dither) {
+		set(duty >> 8);
+		return;
+	}
+
+	// Update once per PWM period, unless the PWM interrupt does
+	if (config::PWM_period == 0 || ++ticks < config::PWM_period)
+		return;
+	ticks = 0;
+	dither();
+}
+
+void Solenoid::dither() {
+	// Duty cycle plus the error carried over
+	uint32_t value = duty + error;
+	error = value & 0xFF;
+	set(value >> 8);
+}
+
+void Solenoid::set(uint32_t value) {
+	// A value of range would overflow the PWM register on some MCUs: clip to fully on
+	if (value > range - 1)
+		value = range - 1;
+
+	if (value == lastValue)
+		return;
+	lastValue = value;
+	analogWrite(pin, static_cast<int>(value));
+}
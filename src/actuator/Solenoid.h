@@ -0,0 +1,78 @@
+#ifndef HUMIDISTAT_SOLENOID_H
+#define HUMIDISTAT_SOLENOID_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include CONFIG_HEADER
+#include "../ValveTable.h"
+
+/// Drives a solenoid valve using PWM.
+/// Optionally, the control variable is linearised through a lookup table (see ValveTable) before it is written.
+/// Optionally (see PWM_dither), the duty cycle is dithered across PWM periods using first-order sigma-delta
+/// modulation: the quantisation error of each period is carried over to the next, so that the average duty cycle has
+/// 8 more bits of resolution than the PWM itself (at the expense of some ripple).
+class Solenoid {
+private:
+	const uint8_t pin;
+	const uint32_t range;                             //!< Number of PWM steps (2^pwmRes)
+	const ValveTable<config::VT_nPoints> *const table; //!< Linearisation table (or nullptr)
+
+	double input = NAN;              //!< Last input (cv or duty cycle) that was converted
+	bool linearised = false;         //!< Whether the last input was passed through the table
+	uint32_t duty = 0;               //!< Duty cycle (in PWM steps, with 8 fractional bits)
+	uint32_t lastValue = 0xFFFFFFFF; //!< Last value written to the pin
+	uint8_t error = 0;               //!< Quantisation error carried over (in 1/256 PWM steps)
+	uint8_t ticks = 0;               //!< Number of ticks since the last PWM period
+
+	/// Convert an input to the duty cycle in PWM steps, unless it is the same as the last one. The conversion is done
+	/// in floating point, which is slow on MCUs without an FPU, while the input typically changes once per cycle.
+	/// \param input      Control variable or duty cycle
+	/// \param linearised Whether to pass the input through the table
+	void convert(double input, bool linearised);
+
+	/// Scale a duty cycle to PWM steps (clipped to 0-1).
+	/// \param duty Duty cycle (0-1)
+	/// \return Duty cycle (in PWM steps, with 8 fractional bits)
+	[[nodiscard]] uint32_t scale(double duty) const;
+
+	/// Write the duty cycle to the pin, or if dithering, count the ticks and dither once per PWM period (unless this
+	/// is done from the PWM interrupt).
+	void output();
+
+	/// Write a value to the pin (if it has changed).
+	/// \param value PWM value
+	void set(uint32_t value);
+
+public:
+	/// Constructor.
+	/// \param pin    Solenoid pin
+	/// \param pwmRes PWM resolution (bits)
+	/// \param table  Pointer to a linearisation table, or nullptr to write the control variable as duty cycle
+	Solenoid(uint8_t pin, uint8_t pwmRes, const ValveTable<config::VT_nPoints> *table = nullptr);
+
+	/// Set the control variable, linearised through the table (if any). Call this from the control tick, every tick.
+	/// \param cv Control variable (0-1): fraction of the maximum flowrate if linearised, else duty cycle
+	void write(double cv);
+
+	/// Set the duty cycle directly, bypassing the table. Call this from the control tick, every tick.
+	/// \param duty Duty cycle (0-1)
+	void writeRaw(double duty);
+
+	/// Convert a control variable to a duty cycle for writeDuty(), through the table (if any). This is done in
+	/// floating point, so that on MCUs without an FPU, it is best kept out of the control tick.
+	/// \param cv Control variable (0-1): fraction of the maximum flowrate if linearised, else duty cycle
+	/// \return Duty cycle (in PWM steps, with 8 fractional bits)
+	[[nodiscard]] uint32_t toDuty(double cv) const;
+
+	/// Set a duty cycle converted by toDuty(). Call this from the control tick, every tick.
+	/// \param duty Duty cycle (in PWM steps, with 8 fractional bits)
+	void writeDuty(uint32_t duty);
+
+	/// Write the dithered duty cycle for the next PWM period. With PWM_period = 0, call this from the overflow
+	/// interrupt of the timer driving the PWM; otherwise, write() and writeRaw() call it every PWM_period ticks.
+	void dither();
+};
+
+
+#endif //HUMIDISTAT_SOLENOID_H
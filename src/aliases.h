@@ -7,15 +7,39 @@
 /// polymorphism' in an attempt to avoid run-time polymorphism with interfaces with virtual methods.
 
 // Humidity sensor
-#ifdef HUMIDISTAT_DHT
+#if defined(HUMIDISTAT_DHT) && defined(HUMIDISTAT_SHT)
+#include "sensor/DHTHumiditySensor.h"
+#include "sensor/SHTHumiditySensor.h"
+#include "sensor/FusedHumiditySensor.h"
+using HumiditySensor = FusedHumiditySensor<SHTHumiditySensor, DHTHumiditySensor>;
+#elif defined(HUMIDISTAT_DHT)
 #include "sensor/DHTHumiditySensor.h"
 using HumiditySensor = DHTHumiditySensor;
-#endif
-#ifdef HUMIDISTAT_SHT
+#elif defined(HUMIDISTAT_SHT) && defined(HUMIDISTAT_SHT_PAIR)
+#include "sensor/SHTHumiditySensor.h"
+#include "sensor/FusedHumiditySensor.h"
+using HumiditySensor = FusedHumiditySensor<SHTHumiditySensor, SHTHumiditySensor>;
+#elif defined(HUMIDISTAT_SHT)
 #include "sensor/SHTHumiditySensor.h"
 using HumiditySensor = SHTHumiditySensor;
 #endif
 
+// PID arithmetic
+#ifdef HUMIDISTAT_PID_FIXED
+#include "Fixed.h"
+using PIDScalar = q16_16;
+#else
+using PIDScalar = double;
+#endif
+
+// PID gains
+#include <etl/type_traits.h>
+#include "control/PIDGains.h"
+using HCGains = etl::conditional_t<config::staticGains, StaticGains<PIDScalar, config::HC_gains>,
+                                   RuntimeGains<PIDScalar>>;
+using FCGains = etl::conditional_t<config::staticGains, StaticGains<PIDScalar, config::FC_gains>,
+                                   RuntimeGains<PIDScalar>>;
+
 // Input
 #ifdef HUMIDISTAT_INPUT_KS0256
 #include "input/Ks0256VoltLadder.h"
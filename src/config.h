@@ -5,6 +5,8 @@
 #include <etl/span.h>
 
 #include "Point.h"
+#include "GainSchedule.h"
+#include "ValveTable.h"
 
 /// Define either HUMIDISTAT_CONTROLLER_SINGLE or HUMIDISTAT_CONTROLLER_CASCADE. In the latter case, flow sensors
 /// must be connected to PIN_F1 and PIN_F2.
@@ -17,6 +19,12 @@
 //#define HUMIDISTAT_DHT
 //#define HUMIDISTAT_SHT
 
+/// For redundancy, the readings of two sensors in the chamber can be fused (see FS_tolerance and FS_timeout below).
+/// Define both HUMIDISTAT_DHT and HUMIDISTAT_SHT for an SHT85 and a DHT22 (with a single channel). Or, define
+/// HUMIDISTAT_SHT_PAIR along with HUMIDISTAT_SHT for two SHT85s for each channel: these must be connected through a
+/// TCA9548A I2C multiplexer (the sensors of channel i on channels 2i and 2i + 1).
+//#define HUMIDISTAT_SHT_PAIR
+
 /// Define either HUMIDISTAT_INPUT_KS0256 or HUMIDISTAT_INPUT_KS0466. In either case, the keypad must be connected to
 /// PIN_BTN specified below.
 //#define HUMIDISTAT_INPUT_KS0256
@@ -28,6 +36,10 @@
 //#define HUMIDISTAT_UI_CHAR
 //#define HUMIDISTAT_UI_GRAPH
 
+/// Optionally, define HUMIDISTAT_PID_FIXED to do the PID arithmetic in fixed-point instead of floating-point. This is
+/// considerably faster on MCUs without an FPU (such as the ATmega328P and the Cortex-M0+).
+//#define HUMIDISTAT_PID_FIXED
+
 namespace config {
 	/// Serial communication symbol rate (baud)
 	const uint32_t serialRate = 115200;
@@ -35,41 +47,330 @@ namespace config {
 	/// Set to true to override the values stored in EEPROM and use the default PID parameters defined below.
 	const bool overrideEEPROM = false;
 
+	/// Set to true to fix the PID gains at compile time to the values defined below. This allows the compiler to
+	/// optimise the PID code (e.g. removing the derivative term entirely if Kd = 0), but makes the gains
+	/// non-adjustable in the UI. Requires overrideEEPROM.
+	const bool staticGains = false;
+
 	/// EEPROM address for storing the block
 	const uint8_t EEPROMAddress = 0;
 
+	/// Number of independent control channels (chambers), each with its own sensor, solenoid valves (and flow sensors),
+	/// controller and config store. More than one channel requires a Teensy 4.0 with SHT85 sensors: these all have the
+	/// same I2C address, so they must be connected through a TCA9548A I2C multiplexer (sensor i on channel i). The pins
+	/// for each channel are given in PIN_S and PIN_F below. The UI and setpoint profiles operate on the first channel.
+	const uint8_t nChannels = 1;
+
+	/// I2C address of the TCA9548A multiplexer (only used if nChannels > 1, or with HUMIDISTAT_SHT_PAIR)
+	const uint8_t I2CMuxAddress = 0x70;
+
+	/// I2C clock frequency (in Hz), for the SHT85 sensors (and the multiplexer)
+	const uint32_t I2C_clock = 400000;
+
+	/// @name Background ADC scan
+	/// The analog inputs are sampled round-robin in the background, and oversampled 4^ADC_extraBits times for
+	/// ADC_extraBits more bits of resolution (at most 3). On Teensy, one conversion is done per control tick, so fewer
+	/// samples keep the values fresh.
+	///@{
+#ifdef ARDUINO_AVR_UNO
+	const uint8_t ADC_extraBits = 2;
+#else
+	const uint8_t ADC_extraBits = 1;
+#endif
+	/// Number of analog inputs: the keypad, the thermistors and their reference, and the flow sensors (if any). Raise
+	/// this when adding an analog input, and count the input in the check in config_assert.h.
+#ifdef HUMIDISTAT_CONTROLLER_CASCADE
+	const uint8_t ADC_nChannels = 6 + 2 * nChannels;
+#else
+	const uint8_t ADC_nChannels = 6;
+#endif
+	///@}
+
+	/// @name Humidity sensor fusion
+	/// With two humidity sensors in the chamber (see the top of this file), their readings are cross-checked and
+	/// averaged, weighted by the inverse of their noise variance. When they disagree, the one closest to the previous
+	/// humidity is used alone; when one has not returned a valid reading for a while, the other one is used alone.
+	///@{
+	const double FS_tolerance = 5;    //!< Largest difference between agreeing readings (in percentage points)
+	const uint16_t FS_timeout = 5000; //!< Time after which a sensor without a valid reading drops out (in ms)
+	///@}
+
+	/// Interval for reading the thermistors (in millis)
+	const uint16_t NTC_interval = 1000;
+
 	/// Global interval for PID/logger (based on polling rate of sensor, in millis)
-#ifdef HUMIDISTAT_SHT
+#if defined(HUMIDISTAT_SHT) && !defined(HUMIDISTAT_DHT)
 	const uint16_t dt = 250;
 #else
 	const uint16_t dt = 500;
 #endif
 
+	/// Set to true to run the cycles of the humidity controller (PID, setpoint ramp, Smith predictor and estimator) in
+	/// the main loop, instead of in the control tick. The tick then only counts the timestep and the due cycles, and
+	/// drives the solenoids. On the Arduino Uno, floating-point arithmetic is emulated in software, so a cycle takes
+	/// far longer than a tick should block the other interrupts (the DHT sensor, the ADC and millis()). Only supported
+	/// by the single humidistat.
+	/// No cycle is lost, so the controller keeps time with the tick, but the outputs are applied late by up to the
+	/// runtime of the longest task in the main loop (see the README).
+#ifdef ARDUINO_AVR_UNO
+	const bool deferCycles = true;
+#else
+	const bool deferCycles = false;
+#endif
+
 	/// @name Humidity controller PID parameters
 	///@{
-	const double HC_Kp = 0.01;
-	const double HC_Ki = 0.001;
-	const double HC_Kd = 0.01;
-	const double HC_Kf = 0.01;
+	constexpr double HC_Kp = 0.01;
+	constexpr double HC_Ki = 0.001;
+	constexpr double HC_Kd = 0.01;
+	constexpr double HC_Kf = 0.01;
+	const uint8_t HC_b = 100; //!< Setpoint weight for the proportional term (in percent)
+	const uint8_t HC_c = 0;   //!< Setpoint weight for the derivative term (in percent)
+	/// Tracking time constant for anti-windup through back-calculation (in s), or 0 for conditional integration (the
+	/// default). A rule of thumb is the integral time (Kp/Ki). For the cascade controller, the outer loop then also
+	/// tracks the wet fraction actually realised when an inner loop is saturated.
+	const double HC_Tt = 0;
+	///@}
+
+	/// @name Setpoint ramp
+	/// Setpoint changes can be passed through a trajectory generator, which limits the rate (and optionally the
+	/// acceleration) of the setpoint seen by the humidity controller, so that a step does not drive the solenoids into
+	/// saturation. Set to 0 to disable a limit. These are stored as integers in EEPROM.
+	///@{
+	const uint8_t SP_rampRate = 0;  //!< Rate limit (in %RH/min)
+	const uint8_t SP_rampAccel = 0; //!< Acceleration limit (in %RH/min per s)
+	///@}
+
+	/// @name Sensor pre-filter
+	/// The samples of the humidity and flow sensors pass through a Hampel filter before reaching the controllers: a
+	/// sample deviating from the median of the last few samples (the window) by more than PF_threshold standard
+	/// deviations (estimated from the median absolute deviation, which is floored at the resolution of the sensor) is
+	/// replaced by the median. Set a window to 1 sample to disable the filter, or the threshold to 0 for a plain median
+	/// filter. Optionally, the rate of change of the filtered value is limited.
+	/// Missing humidity samples are bridged by holding the last value; after HC_PF_staleLimit consecutive missing
+	/// samples, the humidity controller fails over to manual mode, holding its CV.
+	///@{
+	const uint8_t HC_PF_window = 5;        //!< Window length for the humidity (in samples)
+	const uint8_t FC_PF_window = 3;        //!< Window length for the flowrate (in samples)
+	const double PF_threshold = 3;         //!< Outlier threshold (in standard deviations)
+	const double HC_PF_resolution = 0.1;   //!< Resolution of the humidity sensor (in %RH)
+	const double FC_PF_resolution = 0.005; //!< Resolution of the flow sensors (in L/min, about a step of the ADC)
+	const double HC_PF_maxRate = 0;        //!< Rate limit for the humidity (in %RH/s), or 0 for none
+	const double FC_PF_maxRate = 0;        //!< Rate limit for the flowrate (in L/min per s), or 0 for none
+	const uint8_t HC_PF_staleLimit = 20;   //!< Number of missing humidity samples before failing over, or 0 for never
+	///@}
+
+	/// @name Humidity controller gain scheduling
+	/// Optionally, the humidity controller gains can be scheduled: interpolated from a table of breakpoints indexed by
+	/// the setpoint (or the process variable), instead of using HC_Kp/Ki/Kd. The table is stored in EEPROM, and when
+	/// autotuning, the tuned gains are written into the breakpoint nearest to the setpoint. Not compatible with
+	/// staticGains.
+	///@{
+	const bool gainScheduling = false;
+
+	/// Set to true to index the schedule by the process variable instead of the setpoint
+	const bool gainScheduleOnPV = false;
+
+	/// Number of breakpoints
+	const uint8_t GS_nPoints = 5;
+
+	/// Breakpoints: relative humidity (in percent), Kp, Ki, Kd. Must be sorted by relative humidity.
+	constexpr GainSchedule<GS_nPoints> HC_gainSchedule = {{
+			{10, HC_Kp, HC_Ki, HC_Kd},
+			{30, HC_Kp, HC_Ki, HC_Kd},
+			{50, HC_Kp, HC_Ki, HC_Kd},
+			{70, HC_Kp, HC_Ki, HC_Kd},
+			{90, HC_Kp, HC_Ki, HC_Kd},
+	}};
+	///@}
+
+	/// @name Humidity controller dead-time compensation
+	/// Optionally, a Smith predictor can compensate for the transport delay between the solenoid valves and the
+	/// humidity sensor, which allows for more aggressive gains. It uses a first-order-plus-dead-time model of the
+	/// process, of which the parameters are stored in EEPROM.
+	///@{
+	const bool smithPredictor = false;
+
+	constexpr double HC_modelK = 100;  //!< Process gain (percentage points RH per unit of CV)
+	constexpr double HC_modelTau = 30; //!< Time constant (in seconds)
+	constexpr double HC_modelL = 5;    //!< Dead time (in seconds)
+
+	/// Length of the delay line. The maximum dead time is SP_length - 1 timesteps: here, 20 s at the default dt. dt can
+	/// be changed at run-time, so the maximum is shorter at a shorter dt: a longer dead time is then clamped, which is
+	/// flagged on the display and over serial.
+	const uint8_t SP_length = smithPredictor ? 20 * 1000 / dt + 1 : 1;
+	///@}
+
+	/// @name Humidity estimator
+	/// Optionally, a Kalman filter can estimate the humidity at every PID cycle, bridging the interval between (and
+	/// dropouts of) samples of the humidity sensor. For the cascade controller, it predicts the humidity using a mixing
+	/// model based on the measured flowrates.
+	///@{
+	const bool estimator = false;
+
+	/// Process noise variance (in percentage points squared per second)
+	const double KF_processNoise = 0.05;
+
+	/// Measurement noise variance (in percentage points squared)
+#ifdef HUMIDISTAT_SHT
+	const double KF_measurementNoise = 0.01;
+#else
+	const double KF_measurementNoise = 0.25;
+#endif
+
+	/// Volume of the chamber (in L)
+	const double KF_chamberVolume = 1;
+
+	/// Humidity of the wet and dry lines (in percent)
+	const double KF_wetHumidity = 100;
+	const double KF_dryHumidity = 0;
+
+	/// Smoothing factor of the EWA of the normalised innovation squared
+	const double KF_nisSmoothing = 0.05;
+	///@}
+
+	/// @name Mixing feed-forward
+	/// Optionally (for the cascade controller), the humidity controller gets a model-based feed-forward: the
+	/// steady-state wet fraction for the setpoint, from the humidities of the wet and dry lines (KF_wetHumidity,
+	/// KF_dryHumidity, at FF_lineTemperature) and the chamber temperature measured by the humidity sensor. The PID then
+	/// only corrects the residual error. It replaces the feed-forward on the setpoint (HC_Kf is then ignored).
+	///@{
+	const bool mixingFeedForward = false;
+
+	/// Temperature of the wet and dry lines (in Celsius)
+	const double FF_lineTemperature = 21;
+	///@}
+
+	/// @name Model predictive control
+	/// Optionally (for the cascade controller on the Teensy 4.0), the outer PID loop can be replaced by a model
+	/// predictive controller, which chooses the flowrate setpoints of the wet and dry lines directly. It uses the
+	/// mixing model of the estimator (KF_chamberVolume, KF_wetHumidity, KF_dryHumidity), with the dead time of the
+	/// process model (HC_modelL) as transport delay. The flowrate of each line is bounded by [0, HC_totalFlowrate].
+	///@{
+	const bool mpc = false;
+
+	/// Timestep (in ms)
+	const uint16_t MPC_dt = 1000;
+
+	/// Horizon (in timesteps). If mpc is disabled, the buffers of the controller shrink to a single step.
+	const uint8_t MPC_horizon = 15;
+
+	/// Maximum transport delay (in timesteps)
+	const uint8_t MPC_maxDelay = 20;
+
+	/// Number of iterations of the solver (the solve time is proportional to this). A step runs in the humidistat task
+	/// of the main loop (with a budget of 20 ms), not in the control tick: see test/test_mpc for a benchmark.
+	const uint8_t MPC_iterations = 50;
+
+	/// Weight of the deviation of the total flowrate from HC_totalFlowrate (in (RH/(L/min))^2)
+	const double MPC_totalWeight = 100;
+
+	/// Weight of changes in the flowrates (in (RH/(L/min))^2)
+	const double MPC_moveWeight = 1;
 	///@}
 
 	/// @name Flow controller PID parameters
 	///@{
-	const double FC_Kp = 0.005;
-	const double FC_Ki = 0.05;
-	const double FC_Kd = 0;
-	const double FC_Kf = 0;
+	constexpr double FC_Kp = 0.005;
+	constexpr double FC_Ki = 0.05;
+	constexpr double FC_Kd = 0;
+	constexpr double FC_Kf = 0;
 	const uint16_t FC_dt = 100;
+	const uint8_t FC_b = 100; //!< Setpoint weight for the proportional term (in percent)
+	const uint8_t FC_c = 0;   //!< Setpoint weight for the derivative term (in percent)
+	const double FC_Tt = 0;   //!< Tracking time constant (in s), or 0 for conditional integration (see HC_Tt)
+	///@}
+
+	/// @name PID parameters bundled for use as compile-time constants (see staticGains)
+	///@{
+	struct HC_gains {
+		static constexpr double Kp = HC_Kp, Ki = HC_Ki, Kd = HC_Kd, Kf = HC_Kf;
+		static constexpr uint16_t dt = config::dt;
+	};
+	struct FC_gains {
+		static constexpr double Kp = FC_Kp, Ki = FC_Ki, Kd = FC_Kd, Kf = FC_Kf;
+		static constexpr uint16_t dt = FC_dt;
+	};
+	///@}
+
+	/// @name Relay autotuner
+	///@{
+
+	/// Relay amplitude (as a fraction of the range of the control variable)
+	constexpr double AT_amplitude = 0.25;
+
+	/// Relay hysteresis for the humidity controller (in percentage points)
+	const double HC_AT_hysteresis = 0.5;
+
+	/// Relay hysteresis for the flow controller (in L/min)
+	const double FC_AT_hysteresis = 0.02;
+
+	/// Number of oscillation periods to average over (the first period is discarded)
+	const uint8_t AT_periods = 4;
+
+	/// Time after which to give up autotuning a loop (in seconds)
+	const uint16_t AT_timeout = 1800;
 	///@}
 
 	/// Minimum solenoid duty cycle (deadband)
-	const double S_lowValue = 0.75;
+	constexpr double S_lowValue = 0.75;
+
+	/// @name Solenoid valve linearisation
+	/// Optionally, the control variable (for each valve) is linearised through an inverse lookup table (see ValveTable)
+	/// before it is written to the valve, instead of being mapped onto [S_lowValue, 1]. The control variable then is a
+	/// fraction of the maximum flowrate through the valve, which makes the loop gain uniform. The tables are stored in
+	/// EEPROM. With the cascade controller, they can be calibrated on the device (using the flow sensors); the
+	/// calibrated tables are printed over serial, so that they can be entered below for a single humidistat.
+	///@{
+	const bool valveLinearization = false;
+
+	/// Number of entries of the tables
+	const uint8_t VT_nPoints = 9;
+
+	/// Default tables (for the two valves), equivalent to no linearisation
+	constexpr ValveTable<VT_nPoints> S_valveTables[2] = {ValveTable<VT_nPoints>::linear(S_lowValue, 1),
+	                                                     ValveTable<VT_nPoints>::linear(S_lowValue, 1)};
+
+	/// Number of steps of the calibration sweep
+	const uint8_t VC_steps = valveLinearization ? 21 : 2;
+
+	/// Duration of each step of the calibration sweep (in ms)
+	const uint16_t VC_stepTime = 3000;
+
+	/// Fraction of the maximum flowrate below which the valve is considered closed
+	const double VC_threshold = 0.01;
+	///@}
+
+	/// Set to true to dither the solenoid duty cycles across PWM periods (first-order sigma-delta modulation). This
+	/// raises the effective PWM resolution by 8 bits, at the expense of some ripple. Most useful on the Arduino Uno,
+	/// which only has 8-bit PWM (so only about 64 steps above S_lowValue).
+#ifdef ARDUINO_AVR_UNO
+	const bool PWM_dither = true;
+#else
+	const bool PWM_dither = false;
+#endif
+
+	/// PWM period (in ticks): when dithering, the duty cycle is updated once per period. This must be exact, or else
+	/// some updates are overwritten before the PWM has output them. On the Teensy, the PWM runs at 500 Hz, i.e. every 2
+	/// ticks. On the Arduino Uno, the PWM of Timer2 runs at 490.2 Hz (2.04 ms), which is not a multiple of the tick:
+	/// set to 0 to update the duty cycle from the Timer2 overflow interrupt instead, which fires once per PWM period.
+#ifdef ARDUINO_AVR_UNO
+	const uint8_t PWM_period = 0;
+#else
+	const uint8_t PWM_period = 2;
+#endif
 
 	/// Total flowrate (for cascade controller) (L/min)
 	const double HC_totalFlowrate = 2;
 
-	/// Smoothing factor of EMA filter for derivative
-	const double a = 0.75;
+	/// @name Derivative filter
+	///@{
+	/// Time constant of the derivative filter of the humidity controller (in s). Raise this to use Kd with a noisy
+	/// sensor (such as the DHT22) without chatter on the CV.
+	const double HC_Tf = 0.2;
+	const double FC_Tf = 0.1; //!< Time constant of the derivative filter of the flow controllers (in s)
+	const uint8_t D_filterOrder = 1; //!< Order of the derivative filters (1 or 2)
+	///@}
 
 	/// @name Pins
 	///@{
@@ -79,6 +380,9 @@ namespace config {
 	const uint8_t PIN_S1 = 3;
 	const uint8_t PIN_S2 = 11;
 
+	/// Solenoid valve pins for each channel
+	const uint8_t PIN_S[][2] = {{PIN_S1, PIN_S2}};
+
 	/// @name 16x2 LCD pins
 	///@{
 	const uint8_t PIN_LCD_RS = 8;
@@ -105,6 +409,14 @@ namespace config {
 	const uint8_t PIN_F1 = A1;
 	const uint8_t PIN_F2 = A2;
 
+	/// @name Pins for each channel
+	/// Solenoid valve pins (PWM-capable) and flow sensor pins (analog) for each channel. Entries beyond nChannels are
+	/// ignored.
+	///@{
+	const uint8_t PIN_S[][2] = {{PIN_S1, PIN_S2}, {5, 6}, {7, 8}};
+	const uint8_t PIN_F[][2] = {{PIN_F1, PIN_F2}, {A3, A10}, {A11, A12}};
+	///@}
+
 	/// ST7920 LCD pins
 	const uint8_t PIN_LCD_CS = 10;
 	const uint8_t PIN_LCD_MOSI = 11;
@@ -17,4 +17,43 @@
 #error No UI type defined! Configure the firmware in src/config.h first.
 #endif
 
+static_assert(!config::staticGains || config::overrideEEPROM, "staticGains requires overrideEEPROM to be set");
+static_assert(!config::gainScheduling || !config::staticGains, "gainScheduling is not compatible with staticGains");
+static_assert(config::HC_gainSchedule.isSorted(), "HC_gainSchedule must be sorted");
+static_assert(config::S_valveTables[0].isValid() && config::S_valveTables[1].isValid(),
+              "S_valveTables must be monotone (and not constant)");
+static_assert(config::AT_amplitude > 0 && config::AT_amplitude <= 0.5, "AT_amplitude must be in (0, 0.5]");
+
+#ifndef ARDUINO_AVR_UNO
+static_assert(config::PWM_period > 0, "PWM_period = 0 (dithering from the Timer2 interrupt) requires an Arduino Uno");
+#endif
+
+static_assert(config::ADC_extraBits <= 3, "ADC_extraBits must be at most 3 (the sums of the samples are 16-bit)");
+
+static_assert(config::nChannels >= 1, "nChannels must be at least 1");
+static_assert(config::nChannels <= sizeof(config::PIN_S) / sizeof(config::PIN_S[0]),
+              "Not enough solenoid valve pins (PIN_S) defined for nChannels");
+#ifdef HUMIDISTAT_CONTROLLER_CASCADE
+static_assert(config::nChannels <= sizeof(config::PIN_F) / sizeof(config::PIN_F[0]),
+              "Not enough flow sensor pins (PIN_F) defined for nChannels");
+#endif
+// The keypad, the four thermistors and their reference, and the two flow sensors of each channel
+#ifdef HUMIDISTAT_CONTROLLER_CASCADE
+static_assert(config::ADC_nChannels >= 6 + 2 * config::nChannels, "ADC_nChannels is too small for the analog inputs");
+#else
+static_assert(config::ADC_nChannels >= 6, "ADC_nChannels is too small for the analog inputs");
+#endif
+#if !defined(ARDUINO_TEENSY40) || !defined(HUMIDISTAT_SHT) || defined(HUMIDISTAT_DHT)
+static_assert(config::nChannels == 1, "Multiple channels require a Teensy 4.0 and SHT85 sensors");
+#endif
+#if defined(HUMIDISTAT_SHT_PAIR) && (!defined(HUMIDISTAT_SHT) || defined(HUMIDISTAT_DHT))
+#error HUMIDISTAT_SHT_PAIR requires HUMIDISTAT_SHT (and not HUMIDISTAT_DHT)
+#endif
+#ifdef HUMIDISTAT_CONTROLLER_CASCADE
+static_assert(!config::deferCycles, "deferCycles requires the single humidistat");
+#endif
+#if !defined(ARDUINO_TEENSY40) || !defined(HUMIDISTAT_CONTROLLER_CASCADE)
+static_assert(!config::mpc, "mpc requires a Teensy 4.0 and the cascade controller");
+#endif
+
 #endif //HUMIDISTAT_CONFIG_ASSERT_H
@@ -1,24 +1,86 @@
 #include "CascadeHumidistat.h"
+#include "../psychrometrics.h"
 
-CascadeHumidistat::CascadeHumidistat(HumiditySensor *hs, const ConfigStore *cs,
+CascadeHumidistat::CascadeHumidistat(HumiditySensor *hs, ConfigStore *cs,
                                      etl::span<const FlowSensor, 2> flowSensors, etl::array<uint8_t, 2> pins_solenoid,
-									 uint8_t pwmRes)
-		: Humidistat(cs, hs, cs->HC_Kp, cs->HC_Ki, cs->HC_Kd, cs->HC_Kf, cs->dt, 0, 1),
-		  fcs{FlowController(&flowSensors[0], cs, pins_solenoid[0], pwmRes),
-		      FlowController(&flowSensors[1], cs, pins_solenoid[1], pwmRes)} {
+									 uint8_t pwmRes, uint8_t channel)
+		: Humidistat(cs, hs, cs->HC_Kp, cs->HC_Ki, cs->HC_Kd, cs->HC_Kf, cs->dt, 0, 1, channel),
+		  fcs{FlowController(&flowSensors[0], cs, pins_solenoid[0], pwmRes,
+		                     config::valveLinearization ? &cs->S_valveTables[0] : nullptr),
+		      FlowController(&flowSensors[1], cs, pins_solenoid[1], pwmRes,
+		                     config::valveLinearization ? &cs->S_valveTables[1] : nullptr)} {
 	fcs[0].active = true;
 	fcs[1].active = true;
+
+	// The mixing feed-forward gives the steady-state wet fraction for the setpoint, which Kf * sp would count again
+	pid.setSetpointFeedForward(!config::mixingFeedForward);
+	mpc.setDelay(cs->HC_modelL);
+}
+
+void CascadeHumidistat::tick() {
+	// The first flow controller drives the wet line, the second one the dry line
+	double wetFlow = fcs[0].getTickFlowrate();
+	double dryFlow = fcs[1].getTickFlowrate();
+
+	// A saturated inner loop does not realise its setpoint: let the outer loop track the wet fraction that is actually
+	// realised, so that its integral does not wind up
+	bool saturated = fcs[0].isTickSaturated() || fcs[1].isTickSaturated();
+	if (saturated && wetFlow + dryFlow > 0)
+		pid.setTracking(true, wetFlow / (wetFlow + dryFlow));
+	else
+		pid.setTracking(false);
+
+	// Run the estimator at the rate of the flow controllers, so that the estimate follows the flowrates between the
+	// samples of the humidity sensor
+	if (++ticksSinceEstimate >= cs.FC_dt * 1000UL / ControlTimer::interval) {
+		ticksSinceEstimate = 0;
+		runEstimator(cs.FC_dt, wetFlow, dryFlow);
+	}
+
+	if (cycleDue(cs.dt))
+		runCycle();
+
+	if (config::mpc && tickState.active && !autotuner.isRunning()) {
+		// Set the flowrates chosen by the MPC as SP of flow controllers, and express them as CV (wet fraction)
+		fcs[0].setTickSetpoint(tickFlowSPs[0]);
+		fcs[1].setTickSetpoint(tickFlowSPs[1]);
+		double totalFlowSP = tickFlowSPs[0] + tickFlowSPs[1];
+		if (totalFlowSP > 0)
+			tickState.cv = tickFlowSPs[0] / totalFlowSP;
+	} else {
+		// Set CV of humidity controller as SP of flow controllers
+		fcs[0].setTickSetpoint(     tickState.cv  * cs.HC_totalFlowrate);
+		fcs[1].setTickSetpoint((1 - tickState.cv) * cs.HC_totalFlowrate);
+	}
+
+	fcs[0].tick();
+	fcs[1].tick();
 }
 
 void CascadeHumidistat::update() {
-	runCycle();
+	sample();
+	advanceAutotune();
+	advanceCalibration();
+
+	// Steady-state wet fraction for the setpoint
+	double feedForward = 0;
+	if (config::mixingFeedForward) {
+		double T = getTemperature();
+		if (isnan(T))
+			T = config::FF_lineTemperature;
+		feedForward = mixingWetFraction(rampedSP, T, config::KF_wetHumidity, config::KF_dryHumidity,
+		                                config::FF_lineTemperature);
+	}
 
-	// Set CV of humidity controller as SP of flow controllers
-	fcs[0].sp =      cv  * cs.HC_totalFlowrate;
-	fcs[1].sp = (1 - cv) * cs.HC_totalFlowrate;
+	noInterrupts();
+	pid.setFeedForward(feedForward);
+	exchangeState();
+	fcs[0].exchangeState();
+	fcs[1].exchangeState();
+	interrupts();
 
-	fcs[0].update();
-	fcs[1].update();
+	if (config::mpc)
+		runMPC();
 }
 
 const FlowController *CascadeHumidistat::getInner(uint8_t n) const {
@@ -26,7 +88,146 @@ const FlowController *CascadeHumidistat::getInner(uint8_t n) const {
 }
 
 void CascadeHumidistat::updatePIDParameters() {
+	noInterrupts();
 	pid.setGains(cs.HC_Kp, cs.HC_Ki, cs.HC_Kd, cs.HC_Kf, cs.dt);
+	pid.setWeights(cs.HC_b / 100., cs.HC_c / 100.);
+	pid.setDerivativeFilter(cs.HC_Tf, config::D_filterOrder);
+	updateModel();
+	updateRamp();
+	mpc.setDelay(cs.HC_modelL);
+	interrupts();
+	checkModel();
 	fcs[0].updatePIDParameters();
 	fcs[1].updatePIDParameters();
 }
+
+void CascadeHumidistat::exchangeState() {
+	Humidistat::exchangeState();
+	tickFlowSPs[0] = flowSPs[0];
+	tickFlowSPs[1] = flowSPs[1];
+	if (autotunePhase == AutotunePhase::inner0 || autotunePhase == AutotunePhase::inner1 || calibrating)
+		tickState.active = false;
+}
+
+void CascadeHumidistat::startAutotune() {
+	// Tuned gains would have no effect
+	if (config::staticGains || calibrating)
+		return;
+
+	autotunePhase = AutotunePhase::inner0;
+	fcs[0].startAutotune();
+}
+
+bool CascadeHumidistat::isTuning() const {
+	return autotunePhase != AutotunePhase::none;
+}
+
+void CascadeHumidistat::advanceAutotune() {
+	RelayAutotuner::State state;
+	double Kp, Ki, Kd;
+
+	switch (autotunePhase) {
+		case AutotunePhase::none:
+			return;
+		case AutotunePhase::inner0:
+			state = fcs[0].finishAutotune(cs.FC_Kp, cs.FC_Ki, cs.FC_Kd);
+			if (state == RelayAutotuner::State::done) {
+				fcs[1].startAutotune();
+				autotunePhase = AutotunePhase::inner1;
+			}
+			break;
+		case AutotunePhase::inner1:
+			state = fcs[1].finishAutotune(Kp, Ki, Kd);
+			if (state == RelayAutotuner::State::done) {
+				// Both flow controllers share their gains, so take the average
+				cs.FC_Kp = (cs.FC_Kp + Kp) / 2;
+				cs.FC_Ki = (cs.FC_Ki + Ki) / 2;
+				cs.FC_Kd = (cs.FC_Kd + Kd) / 2;
+				fcs[0].updatePIDParameters();
+				fcs[1].updatePIDParameters();
+
+				Humidistat::startAutotune();
+				autotunePhase = AutotunePhase::outer;
+			}
+			break;
+		case AutotunePhase::outer:
+			state = finishAutotune();
+			if (state == RelayAutotuner::State::done) {
+				updatePIDParameters();
+				autotunePhase = AutotunePhase::none;
+			}
+			break;
+	}
+
+	// Abort the sequence if a phase failed
+	if (state == RelayAutotuner::State::failed)
+		autotunePhase = AutotunePhase::none;
+}
+
+void CascadeHumidistat::runMPC() {
+	if (!active || isTuning()) {
+		// Follow the manual CV, so the tick has sensible setpoints until the first step has run
+		flowSPs[0] = cv * cs.HC_totalFlowrate;
+		flowSPs[1] = (1 - cv) * cs.HC_totalFlowrate;
+		mpcActive = false;
+		return;
+	}
+
+	// Start from the current flowrates when going from manual to auto
+	if (!mpcActive) {
+		mpc.reset(fcs[0].pv, fcs[1].pv);
+		mpcActive = true;
+	} else if (millis() - mpcLastRun < config::MPC_dt) {
+		return;
+	}
+	mpcLastRun = millis();
+
+	mpc.step(estimate, rampedSP, fcs[0].pv, fcs[1].pv, cs.HC_totalFlowrate, flowSPs[0], flowSPs[1]);
+}
+
+void CascadeHumidistat::startCalibration() {
+	// The tables would have no effect
+	if (!config::valveLinearization || isTuning() || calibrating)
+		return;
+
+	calibrating = 0b11;
+	fcs[0].startCalibration();
+	fcs[1].startCalibration();
+}
+
+bool CascadeHumidistat::isCalibrating() const {
+	return calibrating;
+}
+
+void CascadeHumidistat::advanceCalibration() {
+	if (!calibrating)
+		return;
+
+	for (uint8_t i = 0; i < 2; i++) {
+		if (!(calibrating & (1 << i)))
+			continue;
+
+		ValveCalibrator::State state = fcs[i].finishCalibration(cs.S_valveTables[i]);
+		if (state == ValveCalibrator::State::idle)
+			continue;
+		calibrating &= ~(1 << i);
+
+		// Print the table, so that it can be entered in the config (e.g. for a single humidistat)
+		Serial.print("# S_valveTables[");
+		Serial.print(i);
+		Serial.print("]: ");
+		if (state == ValveCalibrator::State::done) {
+			for (uint16_t duty : cs.S_valveTables[i].duty) {
+				Serial.print(duty);
+				Serial.print(' ');
+			}
+			Serial.println();
+		} else {
+			Serial.println("failed");
+		}
+	}
+
+	// Apply the new cv limits (and reinitialise the flow controllers)
+	if (!calibrating)
+		updatePIDParameters();
+}
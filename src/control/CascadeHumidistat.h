@@ -8,13 +8,49 @@
 #include "Humidistat.h"
 #include "../sensor/FlowSensor.h"
 #include "FlowController.h"
+#include "MPC.h"
 
 /// Control humidity using cascade PID: outer PID loop sets setpoints of two inner flow controllers, which drive a
-/// solenoid valve each.
+/// solenoid valve each. Optionally, the outer loop is replaced by a model predictive controller (see MPC).
 /// Adjust the public setpoint variable and call update().
 class CascadeHumidistat : public Humidistat {
 private:
+	/// Phases of the autotuning sequence: the inner loops are tuned first (one after another), then the outer loop.
+	enum class AutotunePhase : uint8_t {
+		none,
+		inner0,
+		inner1,
+		outer,
+	};
+
 	FlowController fcs[2];
+	AutotunePhase autotunePhase = AutotunePhase::none;
+	uint8_t calibrating = 0; //!< Bitmask of the valves being calibrated
+
+	uint16_t ticksSinceEstimate = 0; //!< Number of ticks since the last step of the estimator
+
+	MPC<config::mpc ? config::MPC_horizon : 1, config::mpc ? config::MPC_maxDelay : 1> mpc;
+	bool mpcActive = false;         //!< Whether the MPC was running in the last update()
+	unsigned long mpcLastRun = 0;   //!< Last time the MPC was run (in millis)
+	double flowSPs[2] = {0, 0};     //!< Flowrate setpoints chosen by the MPC
+	double tickFlowSPs[2] = {0, 0}; //!< Flowrate setpoints chosen by the MPC, as seen by the control tick
+
+	/// Run a step of the MPC every MPC_dt, while in auto mode (and not autotuning). The MPC runs in the main loop
+	/// rather than in the control tick, since its solve time is considerable. Call this from update(), after
+	/// exchangeState().
+	void runMPC();
+
+	/// Advance the autotuning sequence when the current phase has finished. Call this from update().
+	void advanceAutotune();
+
+	/// Check whether the calibration of the valves has finished, and if so, apply (and print) the new tables. Call this
+	/// from update().
+	void advanceCalibration();
+
+	/// Exchange the state (including the flowrate setpoints chosen by the MPC) with the tick state. While the inner
+	/// loops are being tuned or the valves are being calibrated, the outer loop is held in manual mode. Call this with
+	/// interrupts disabled.
+	void exchangeState();
 
 public:
 	/// Constructor.
@@ -23,15 +59,33 @@ public:
 	/// \param flowSensors   Span over 2 FlowSensor instances
 	/// \param pins_solenoid Array of 2 integers corresponding to the solenoid pins
 	/// \param pwmRes        PWM resolution (bits)
-	CascadeHumidistat(HumiditySensor *hs, const ConfigStore *cs, etl::span<const FlowSensor, 2> flowSensors,
-					  etl::array<uint8_t, 2> pins_solenoid, uint8_t pwmRes);
+	/// \param channel       Index of the control channel
+	CascadeHumidistat(HumiditySensor *hs, ConfigStore *cs, etl::span<const FlowSensor, 2> flowSensors,
+					  etl::array<uint8_t, 2> pins_solenoid, uint8_t pwmRes, uint8_t channel);
 
 	/// Get a pointer to a inner FlowController instance.
 	/// \param n the index of the FlowController (0 or 1)
 	/// \return pointer to the FlowController instance.
 	[[nodiscard]] const FlowController* getInner(uint8_t n) const;
 
+	/// Start autotuning: first the inner flow loops, then the outer humidity loop. When finished, the tuned gains are
+	/// written into the ConfigStore.
+	void startAutotune();
+
+	/// Whether the autotuning sequence is running.
+	/// \return True if running
+	[[nodiscard]] bool isTuning() const;
+
+	/// Start calibrating the linearisation tables of both valves (simultaneously). When finished, the tables are
+	/// written into the ConfigStore, and printed over serial.
+	void startCalibration();
+
+	/// Whether the valves are being calibrated.
+	/// \return True if calibrating
+	[[nodiscard]] bool isCalibrating() const;
+
 	// Overridden from Controller
+	void tick();
 	void update();
 	void updatePIDParameters();
 };
@@ -3,17 +3,127 @@
 
 #include <stdint.h>
 
+#include "aliases.h"
 #include "PID.h"
+#include "RelayAutotuner.h"
+#include "../ControlTimer.h"
 #include "../EEPROMConfig.h"
 
 /// Base class for a controller.
-/// Owns a PID instance, and holds a reference to a ConfigStore instance.
+/// Owns a PID instance and a RelayAutotuner instance, and holds a reference to a ConfigStore instance.
+///
+/// The controller runs in two contexts: the PID loop runs in tick(), which is called from a timer interrupt, while the
+/// UI and logger access the public state from the main loop. The tick operates on its own copy of the state
+/// (tickState), which is exchanged with the public state in update() with interrupts disabled, so that both
+/// contexts always see a consistent snapshot.
+/// \tparam Gains Type holding the PID gains: either RuntimeGains or StaticGains
+template<class Gains>
 class Controller {
 protected:
-	PID pid;
-	const ConfigStore &cs;
+	/// State owned by the control tick (interrupt context). The PID operates on this.
+	struct {
+		double pv;
+		double fb; //!< Process variable as fed back to the PID (pv, optionally corrected, e.g. for dead time)
+		double sp;
+		double cv;
+		bool active;
+	} tickState;
 
-	unsigned long sensorLastRead = 0;
+	PID<PIDScalar, Gains> pid;
+	RelayAutotuner autotuner;
+	ConfigStore &cs;
+
+	unsigned long sensorLastRead = 0; //!< Last time the sensor was read (in millis)
+	uint16_t ticksSinceCycle = 0;     //!< Number of ticks since the last PID cycle
+
+	double pTerm = 0, iTerm = 0, dTerm = 0; //!< Snapshot of the PID terms
+
+	/// Get the lower limit for the control variable of a loop driving solenoid valves: the deadband S_lowValue, or 0
+	/// if the valves are linearised (the deadband is then part of the table).
+	/// \param cs ConfigStore
+	/// \return Lower limit for the control variable
+	static double solenoidCvMin(const ConfigStore &cs) {
+		return config::valveLinearization ? 0 : cs.S_lowValue;
+	}
+
+	/// Count a tick, and check whether a PID cycle is due. Call this from tick().
+	/// \param dt Timestep (in ms)
+	/// \return True if a PID cycle is due
+	bool cycleDue(uint16_t dt) {
+		if (++ticksSinceCycle < dt * 1000UL / ControlTimer::interval)
+			return false;
+		ticksSinceCycle = 0;
+		return true;
+	}
+
+	/// Run a cycle of the relay experiment instead of the PID loop, if it is running. Call this from tick(), when a
+	/// cycle is due.
+	/// \return True if the relay experiment is running
+	bool runAutotune() {
+		if (!autotuner.isRunning())
+			return false;
+
+		pid.setAuto(false);
+		tickState.cv = autotuner.step(tickState.pv);
+		return true;
+	}
+
+	/// Start the relay experiment around the current setpoint. The relay is centred around the current cv.
+	/// \param eps Hysteresis (in units of the process variable)
+	/// \param dt  Timestep (in ms)
+	void startAutotune(double eps, uint16_t dt) {
+		// Tuned gains would have no effect
+		if (config::staticGains)
+			return;
+
+		double cvMin = static_cast<double>(pid.cvMin);
+		double cvMax = static_cast<double>(pid.cvMax);
+		double d = config::AT_amplitude * (cvMax - cvMin);
+
+		// Keep the relay output within the limits
+		double bias = cv;
+		if (bias < cvMin + d)
+			bias = cvMin + d;
+		if (bias > cvMax - d)
+			bias = cvMax - d;
+
+		noInterrupts();
+		autotuner.start(sp, bias, d, eps, dt, config::AT_periods, config::AT_timeout);
+		interrupts();
+	}
+
+	/// Check whether the relay experiment has finished. If it was successful, the tuned gains are written into the
+	/// given variables (typically in the ConfigStore). Call this from update().
+	/// \param Kp    Proportional gain
+	/// \param Ki    Integral gain (in 1/s)
+	/// \param Kd    Derivative gain (in s)
+	/// \param withD True for PID gains, false for PI gains
+	/// \return State of the relay experiment (done/failed on finishing, idle otherwise)
+	RelayAutotuner::State finishAutotune(double &Kp, double &Ki, double &Kd, bool withD) {
+		RelayAutotuner::State state = autotuner.getState();
+		if (state == RelayAutotuner::State::running)
+			return RelayAutotuner::State::idle;
+
+		if (state == RelayAutotuner::State::done)
+			autotuner.getGains(Kp, Ki, Kd, withD);
+		autotuner.reset();
+		return state;
+	}
+
+	/// Exchange the mode, cv and PID terms between the public state and the tick state. In manual mode, cv is
+	/// written to the tick state, in auto mode (or while autotuning) it is read from it. Call this with interrupts
+	/// disabled.
+	void exchangeState() {
+		tickState.active = active;
+		if (active || autotuner.isRunning())
+			cv = tickState.cv;
+		else
+			tickState.cv = cv;
+
+		pTerm = static_cast<double>(pid.pTerm);
+		iTerm = static_cast<double>(pid.iTerm);
+		dTerm = static_cast<double>(pid.dTerm);
+	}
 
 public:
 	bool active = false;
@@ -31,27 +141,48 @@ public:
 	/// \param dt Timestep (in ms)
 	/// \param cvMin Lower limit for control value
 	/// \param cvMax Upper limit for control value
+	/// \param Tf Time constant of the derivative filter (in s)
 	/// \param defaultSP Default value for the setpoint
 	/// \param defaultCV Default value for the control variable
-	Controller(const ConfigStore *cs, double Kp, double Ki, double Kd, double Kf, uint16_t dt, double cvMin,
-			   double cvMax, double defaultSP, double defaultCV);
+	Controller(ConfigStore *cs, double Kp, double Ki, double Kd, double Kf, uint16_t dt, double cvMin,
+			   double cvMax, double Tf, double defaultSP, double defaultCV)
+		: tickState{0, 0, defaultSP, defaultCV, false},
+		  pid(&tickState.fb, &tickState.cv, &tickState.sp, Kp, Ki, Kd, Kf, dt, cvMin, cvMax, Tf,
+		      config::D_filterOrder), cs(*cs),
+		  sp(defaultSP), cv(defaultCV) {}
 
-	/// Get the three PID terms by reference.
+	/// Get the three PID terms (as of the last update()) by reference.
 	/// \param pTerm
 	/// \param iTerm
 	/// \param dTerm
-	void getTerms(double &pTerm, double &iTerm, double &dTerm) const;
+	void getTerms(double &pTerm, double &iTerm, double &dTerm) const {
+		pTerm = this->pTerm;
+		iTerm = this->iTerm;
+		dTerm = this->dTerm;
+	}
 
-	/// Run the controller:
-	/// Typically reads a sensor, runs a cycle of the PID loop and drives some actuator.
+	/// Run the control tick (call this from the timer interrupt, every ControlTimer::interval):
+	/// Typically runs a cycle of the PID loop every dt and drives some actuator.
+	void tick();
+
+	/// Update the controller (call this from the main loop):
+	/// Typically reads a sensor, and exchanges the state with the control tick.
 	void update();
 
 	/// Update the PID parameters from the configStore.
 	void updatePIDParameters();
 
+	/// Whether the relay autotuner is running.
+	/// \return True if running
+	[[nodiscard]] bool isTuning() const {
+		return autotuner.isRunning();
+	}
+
 	/// Get a pointer to the ConfigStore instance.
 	/// \return pointer to the ConfigStore instance.
-	const ConfigStore *getConfigStore();
+	const ConfigStore *getConfigStore() {
+		return &cs;
+	}
 };
 
 
@@ -2,30 +2,94 @@
 #include "FlowController.h"
 #include "Controller.h"
 
-FlowController::FlowController(const FlowSensor *fs, const ConfigStore *cs, uint8_t solenoidPin, uint8_t pwmRes)
-		: Controller(cs, cs->FC_Kp, cs->FC_Ki, cs->FC_Kd, cs->FC_Kf, cs->FC_dt, cs->S_lowValue, 1, 0, cs->S_lowValue),
-		  fs(*fs), solenoidPin(solenoidPin), pwmRes(pwmRes) {}
+FlowController::FlowController(const FlowSensor *fs, ConfigStore *cs, uint8_t solenoidPin, uint8_t pwmRes,
+                               const ValveTable<config::VT_nPoints> *valveTable)
+		: Controller<FCGains>(cs, cs->FC_Kp, cs->FC_Ki, cs->FC_Kd, cs->FC_Kf, cs->FC_dt, solenoidCvMin(*cs), 1,
+		                      config::FC_Tf, 0, solenoidCvMin(*cs)),
+		  fs(*fs), solenoid(solenoidPin, pwmRes, valveTable),
+		  prefilter(config::PF_threshold, config::FC_PF_resolution, config::FC_PF_maxRate, 0) {
+	pid.setWeights(cs->FC_b / 100., cs->FC_c / 100.);
+	pid.setTrackingTime(config::FC_Tt);
+}
+
+void FlowController::tick() {
+	if (cycleDue(cs.FC_dt)) {
+		// Read flowrate, and filter it (and update PV if not NaN)
+		if (prefilter.update(fs.readFlowrate(), cs.FC_dt))
+			tickState.pv = prefilter.getValue();
+		tickState.fb = tickState.pv;
 
-void FlowController::update() {
-	if (millis() - sensorLastRead < cs.FC_dt)
-		return;
-	sensorLastRead = millis();
+		// Run calibration sweep or relay experiment if running, else run PID cycle if active
+		if (calibrator.isRunning()) {
+			pid.setAuto(false);
+			tickState.cv = calibrator.step(tickState.pv);
+		} else if (!runAutotune()) {
+			pid.setAuto(tickState.active);
+			pid.compute();
+		}
+	}
 
-	pid.setAuto(active);
+	// Actuate solenoid (every tick, for dithering). The calibration sweep bypasses the linearisation.
+	if (calibrator.isRunning())
+		solenoid.writeRaw(tickState.cv);
+	else
+		solenoid.write(tickState.cv);
+}
+
+void FlowController::setTickSetpoint(double sp) {
+	tickState.sp = sp;
+}
+
+double FlowController::getTickFlowrate() const {
+	return tickState.pv;
+}
+
+bool FlowController::isTickSaturated() const {
+	return tickState.cv <= static_cast<double>(pid.cvMin) || tickState.cv >= static_cast<double>(pid.cvMax);
+}
 
-	// Read flowrate (and update PV if not NaN)
-	double flowrate = fs.readFlowrate();
-	if (!isnan(flowrate))
-		pv = flowrate;
+void FlowController::exchangeState() {
+	Controller<FCGains>::exchangeState();
+	pv = tickState.pv;
+	sp = tickState.sp;
+}
 
-	// Run PID cycle if active
-	pid.compute();
+void FlowController::startAutotune() {
+	Controller<FCGains>::startAutotune(config::FC_AT_hysteresis, cs.FC_dt);
+}
 
-	// Actuate solenoid (convert normalised double CV to integer PWM value)
-	analogWrite(solenoidPin, static_cast<int>(cv * ipow(2, pwmRes)));
+RelayAutotuner::State FlowController::finishAutotune(double &Kp, double &Ki, double &Kd) {
+	return Controller<FCGains>::finishAutotune(Kp, Ki, Kd, false);
 }
 
 void FlowController::updatePIDParameters() {
-	pid.setGains(cs.FC_Kp, cs.FC_Ki, cs.FC_Kd, cs.FC_Kf, cs.dt);
-	pid.cvMin = cs.S_lowValue;
+	noInterrupts();
+	pid.setGains(cs.FC_Kp, cs.FC_Ki, cs.FC_Kd, cs.FC_Kf, cs.FC_dt);
+	pid.setWeights(cs.FC_b / 100., cs.FC_c / 100.);
+	pid.setCvLimits(solenoidCvMin(cs), 1);
+	interrupts();
+}
+
+void FlowController::startCalibration() {
+	noInterrupts();
+	calibrator.start(cs.FC_dt);
+	interrupts();
+}
+
+ValveCalibrator::State FlowController::finishCalibration(ValveTable<config::VT_nPoints> &table) {
+	ValveCalibrator::State state = calibrator.getState();
+	if (state == ValveCalibrator::State::running)
+		return ValveCalibrator::State::idle;
+
+	if (state == ValveCalibrator::State::done) {
+		noInterrupts();
+		calibrator.getTable(table);
+		interrupts();
+	}
+	calibrator.reset();
+	return state;
+}
+
+bool FlowController::isCalibrating() const {
+	return calibrator.isRunning();
 }
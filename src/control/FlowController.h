@@ -5,14 +5,20 @@
 #include "PID.h"
 #include "../sensor/FlowSensor.h"
 #include "../EEPROMConfig.h"
+#include "../actuator/Solenoid.h"
+#include "ValveCalibrator.h"
+#include "SensorFilter.h"
 
 /// Controls flow.
-/// Holds a reference to a FlowSensor instance.
-class FlowController : public Controller {
+/// Holds a reference to a FlowSensor instance. Intended as inner loop: the setpoint is set from the control tick by the
+/// outer loop, and the flow sensor is read in the control tick.
+/// Also holds a ValveCalibrator instance, to calibrate the linearisation table of its valve.
+class FlowController : public Controller<FCGains> {
 private:
 	const FlowSensor &fs;
-	const uint8_t solenoidPin;
-	const uint8_t pwmRes;
+	Solenoid solenoid;
+	ValveCalibrator calibrator;
+	SensorFilter<config::FC_PF_window> prefilter;
 
 public:
 	/// Constructor.
@@ -20,10 +26,50 @@ public:
 	/// \param cs          Pointer to a ConfigStore instance
 	/// \param solenoidPin Solenoid pin
 	/// \param pwmRes      PWM resolution (bits)
-	FlowController(const FlowSensor *fs, const ConfigStore *cs, uint8_t solenoidPin, uint8_t pwmRes);
+	/// \param valveTable  Pointer to the linearisation table of the valve, or nullptr
+	FlowController(const FlowSensor *fs, ConfigStore *cs, uint8_t solenoidPin, uint8_t pwmRes,
+	               const ValveTable<config::VT_nPoints> *valveTable = nullptr);
+
+	/// Set the setpoint from the control tick (e.g. by an outer loop).
+	/// \param sp Setpoint
+	void setTickSetpoint(double sp);
+
+	/// Get the flowrate from the control tick (e.g. for an outer loop).
+	/// \return Flowrate (L/min)
+	[[nodiscard]] double getTickFlowrate() const;
+
+	/// Whether the output is saturated (at cvMin or cvMax), from the control tick (e.g. for an outer loop).
+	/// \return True if saturated
+	[[nodiscard]] bool isTickSaturated() const;
+
+	/// Exchange the mode, cv and PID terms with the tick state, and copy the setpoint and process variable from it.
+	/// Call this with interrupts disabled.
+	void exchangeState();
+
+	/// Start autotuning the flow control loop using a relay experiment around the current setpoint.
+	void startAutotune();
+
+	/// Check whether the relay experiment has finished, and if it was successful, get the tuned (PI) gains.
+	/// \param Kp Proportional gain
+	/// \param Ki Integral gain (in 1/s)
+	/// \param Kd Derivative gain (in s)
+	/// \return State of the relay experiment (done/failed on finishing, idle otherwise)
+	RelayAutotuner::State finishAutotune(double &Kp, double &Ki, double &Kd);
+
+	/// Start calibrating the valve: sweep its duty cycle and record the flowrate. The PID is suspended meanwhile.
+	void startCalibration();
+
+	/// Check whether the calibration has finished, and if it was successful, build the linearisation table.
+	/// \param table Table to write into (with interrupts disabled)
+	/// \return State of the calibration (done/failed on finishing, idle otherwise)
+	ValveCalibrator::State finishCalibration(ValveTable<config::VT_nPoints> &table);
+
+	/// Whether the valve is being calibrated.
+	/// \return True if calibrating
+	[[nodiscard]] bool isCalibrating() const;
 
 	// Overridden from Controller
-	void update();
+	void tick();
 	void updatePIDParameters();
 };
 
@@ -1,8 +1,17 @@
+#include <Arduino.h>
+
 #include "Humidistat.h"
 
-Humidistat::Humidistat(const ConfigStore *cs, HumiditySensor *hs, double Kp, double Ki, double Kd, double Kf, uint16_t
-                       dt, double cvMin, double cvMax)
-		: Controller(cs, Kp, Ki, Kd, Kf, dt, cvMin, cvMax, 50, (cvMin + cvMax) / 2), hs(*hs) {}
+Humidistat::Humidistat(ConfigStore *cs, HumiditySensor *hs, double Kp, double Ki, double Kd, double Kf, uint16_t
+                       dt, double cvMin, double cvMax, uint8_t channel)
+		: Controller<HCGains>(cs, Kp, Ki, Kd, Kf, dt, cvMin, cvMax, cs->HC_Tf, 50, (cvMin + cvMax) / 2), hs(*hs),
+		  channel(channel),
+		  prefilter(config::PF_threshold, config::HC_PF_resolution, config::HC_PF_maxRate, config::HC_PF_staleLimit) {
+	pid.setWeights(cs->HC_b / 100., cs->HC_c / 100.);
+	pid.setTrackingTime(config::HC_Tt);
+	updateModel();
+	updateRamp();
+}
 
 double Humidistat::getHumidity() const {
 	return hs.getHumidity();
@@ -12,26 +21,148 @@ double Humidistat::getTemperature() const {
 	return hs.getTemperature();
 }
 
+void Humidistat::sample() {
+	// Request a sample every dt, and pass it on as soon as it has been read
+	if (millis() - sensorLastRead >= cs.dt) {
+		sensorLastRead = millis();
+		hs.requestSample();
+	}
+	if (!hs.readSample())
+		return;
+
+	// Filter the humidity (if not NaN)
+	if (prefilter.update(hs.getHumidity(), cs.dt)) {
+		pv = prefilter.getValue();
+		newSample = true;
+	} else if (prefilter.isStale() && active) {
+		active = false;
+		Serial.print("# Humidity sensor ");
+		Serial.print(channel);
+		Serial.println(" stale: switched to manual");
+	}
+}
+
+void Humidistat::runEstimator(uint16_t dt, double wetFlow, double dryFlow) {
+	if (!config::estimator)
+		return;
+
+	estimator.predict(dt, wetFlow, dryFlow);
+	if (tickNewSample) {
+		estimator.correct(tickState.pv);
+		tickNewSample = false;
+	}
+}
+
 void Humidistat::runCycle() {
-	if (millis() - sensorLastRead < cs.dt)
+	double pv = config::estimator ? estimator.getEstimate() : tickState.pv;
+
+	// Ramp the setpoint towards the target in auto, and start from the process variable when going to auto
+	if (tickState.active) {
+		tickState.sp = setpointRamp.step(tickTargetSP, cs.dt);
+	} else {
+		setpointRamp.reset(pv);
+		tickState.sp = tickTargetSP;
+	}
+
+	// Correct the process variable for the dead time
+	tickState.fb = config::smithPredictor ? smithPredictor.correct(pv) : pv;
+
+	// Run relay experiment instead of PID cycle if autotuning (with model predictive control, the PID is bypassed)
+	if (!runAutotune()) {
+		pid.setAuto(tickState.active && !config::mpc);
+
+		if (config::gainScheduling && tickState.active)
+			scheduleGains();
+
+		// Run PID cycle if active (pid writes into tickState.cv)
+		pid.compute();
+	}
+
+	if (config::smithPredictor)
+		smithPredictor.update(tickState.cv);
+}
+
+void Humidistat::scheduleGains() {
+	double Kp, Ki, Kd;
+	cs.HC_gainSchedule.interpolate(config::gainScheduleOnPV ? tickState.pv : tickState.sp, Kp, Ki, Kd);
+	pid.setGainsBumpless(Kp, Ki, Kd, cs.HC_Kf, cs.dt);
+}
+
+RelayAutotuner::State Humidistat::finishAutotune() {
+	if (config::gainScheduling) {
+		GainPoint &point = cs.HC_gainSchedule.nearest(sp);
+		return Controller<HCGains>::finishAutotune(point.Kp, point.Ki, point.Kd, true);
+	}
+	return Controller<HCGains>::finishAutotune(cs.HC_Kp, cs.HC_Ki, cs.HC_Kd, true);
+}
+
+void Humidistat::exchangeState() {
+	Controller<HCGains>::exchangeState();
+	tickState.pv = pv;
+	tickTargetSP = sp;
+	rampedSP = tickState.sp;
+
+	if (newSample) {
+		tickNewSample = true;
+		newSample = false;
+	}
+
+	if (config::estimator) {
+		estimate = estimator.getEstimate();
+		innovation = estimator.getInnovation();
+		nis = estimator.getNIS();
+	} else {
+		estimate = pv;
+	}
+}
+
+double Humidistat::getRampedSetpoint() const {
+	return rampedSP;
+}
+
+bool Humidistat::isSensorStale() const {
+	return prefilter.isStale();
+}
+
+double Humidistat::getEstimate() const {
+	return estimate;
+}
+
+void Humidistat::getInnovation(double &innovation, double &nis) const {
+	innovation = this->innovation;
+	nis = this->nis;
+}
+
+void Humidistat::updateModel() {
+	smithPredictor.setModel(cs.HC_modelK, cs.HC_modelTau, cs.HC_modelL, cs.dt, tickState.cv);
+}
+
+void Humidistat::checkModel() const {
+	if (!isDeadTimeClamped())
 		return;
-	sensorLastRead = millis();
+	Serial.print("# Dead time of channel ");
+	Serial.print(channel);
+	Serial.print(" clamped to ");
+	Serial.print(smithPredictor.getDelay() * cs.dt / 1000.);
+	Serial.println(" s: lengthen SP_length, or increase dt");
+}
 
-	pid.setAuto(active);
+bool Humidistat::isDeadTimeClamped() const {
+	return config::smithPredictor && smithPredictor.isClamped();
+}
 
-	// Read humidity (if not NaN)
-	hs.readSample();
-	if (!isnan(hs.getHumidity()))
-		pv = hs.getHumidity();
+void Humidistat::updateRamp() {
+	setpointRamp.setLimits(cs.SP_rampRate / 60., cs.SP_rampAccel / 60.);
+}
 
-	// Run PID cycle if active (pid writes into this->cv)
-	pid.compute();
+void Humidistat::startAutotune() {
+	Controller<HCGains>::startAutotune(config::HC_AT_hysteresis, cs.dt);
 }
 
 double Humidistat::getCvMin() const {
-	return pid.cvMin;
+	return static_cast<double>(pid.cvMin);
 }
 
 double Humidistat::getCvMax() const {
-	return pid.cvMax;
+	return static_cast<double>(pid.cvMax);
 }
@@ -3,18 +3,76 @@
 
 #include "aliases.h"
 #include "Controller.h"
+#include "SmithPredictor.h"
+#include "SetpointRamp.h"
+#include "SensorFilter.h"
+#include "HumidityEstimator.h"
 #include "EEPROMConfig.h"
 
 /// Base class for a humidistat.
 /// Holds a reference to a HumiditySensor instance.
-class Humidistat : public Controller {
+class Humidistat : public Controller<HCGains> {
 protected:
 	HumiditySensor &hs;
+	const uint8_t channel; //!< Index of the control channel (in messages over serial)
+	SmithPredictor smithPredictor;
+	HumidityEstimator estimator;
+	SetpointRamp setpointRamp;
+	SensorFilter<config::HC_PF_window> prefilter;
 
-	/// Run a cycle of the controller.
-	/// Reads a sample from the humidity controller and runs PID.
+	bool newSample = false;     //!< Whether a new sample has been read since the last exchange
+	bool tickNewSample = false; //!< Whether a new sample is available to the control tick
+
+	double estimate = 0, innovation = 0, nis = 0; //!< Snapshot of the estimator state
+
+	double tickTargetSP = 0; //!< Target setpoint in the tick state (tickState.sp holds the ramped setpoint)
+	double rampedSP = 0;     //!< Snapshot of the ramped setpoint
+
+	/// Request a sample from the humidity sensor every dt, and pass it through the pre-filter as soon as it has been
+	/// read, so that it reaches the control tick after the conversion time of the sensor rather than a full dt later.
+	/// A missing sample is bridged by holding the process variable; if the sensor has been missing for too long, fail
+	/// over to manual mode (holding the CV). Call this from the main loop, on every pass.
+	void sample();
+
+	/// Run a step of the estimator (if enabled): predict the humidity over the timestep, and correct the prediction
+	/// with the new sample if there is one. The flowrates of the wet and dry lines (if known) are used in the
+	/// prediction step, so that it can run at a higher rate than the samples. Call this from the control tick (or
+	/// wherever runCycle() is called), before runCycle().
+	/// \param dt      Timestep (in ms)
+	/// \param wetFlow Flowrate of the wet line (L/min)
+	/// \param dryFlow Flowrate of the dry line (L/min)
+	void runEstimator(uint16_t dt, double wetFlow = 0, double dryFlow = 0);
+
+	/// Run a cycle of the PID loop. Call this from the control tick when a cycle is due (every dt), or from the main
+	/// loop if the cycles are deferred (see deferCycles).
+	/// If the estimator is enabled, the PID operates on its estimate. In auto mode, the setpoint is ramped towards the
+	/// target, starting from the process variable when going from manual to auto.
 	void runCycle();
 
+	/// Update the process model of the Smith predictor from the ConfigStore. Call this with interrupts disabled.
+	void updateModel();
+
+	/// Print a warning over serial if the dead time of the model was clamped by the last updateModel(). Call this
+	/// after updateModel(), with interrupts enabled.
+	void checkModel() const;
+
+	/// Update the limits of the setpoint ramp from the ConfigStore. Call this with interrupts disabled.
+	void updateRamp();
+
+	/// Interpolate the gains from the gain schedule (at the setpoint or process variable), and apply them bumplessly.
+	/// Call this from the control tick.
+	void scheduleGains();
+
+	/// Check whether the relay experiment has finished. If it was successful, the tuned gains are written into the
+	/// ConfigStore: into the breakpoint of the gain schedule nearest to the setpoint if gain scheduling is enabled,
+	/// else into HC_Kp/Ki/Kd. Call this from update().
+	/// \return State of the relay experiment (done/failed on finishing, idle otherwise)
+	RelayAutotuner::State finishAutotune();
+
+	/// Exchange the setpoint, process variable, mode, cv, PID terms and estimator state with the tick state.
+	/// Call this with interrupts disabled.
+	void exchangeState();
+
 public:
 	/// Constructor.
 	/// \param cs Pointer to a ConfigStore instance
@@ -26,8 +84,9 @@ public:
 	/// \param dt Timestep (in ms)
 	/// \param cvMin Lower limit for control value
 	/// \param cvMax Upper limit for control value
-	Humidistat(const ConfigStore *cs, HumiditySensor *hs, double Kp, double Ki, double Kd, double Kf, uint16_t dt,
-			   double cvMin, double cvMax);
+	/// \param channel Index of the control channel
+	Humidistat(ConfigStore *cs, HumiditySensor *hs, double Kp, double Ki, double Kd, double Kf, uint16_t dt,
+			   double cvMin, double cvMax, uint8_t channel);
 
 	/// Read the humidity.
 	/// \return Relative humidity (percent)
@@ -37,6 +96,35 @@ public:
 	/// \return Temperature (Celsius)
 	double getTemperature() const;
 
+	/// Get the ramped setpoint, i.e. the setpoint seen by the controller (as of the last update()). Equal to the
+	/// (target) setpoint if the ramp is disabled.
+	/// \return Relative humidity (percent)
+	double getRampedSetpoint() const;
+
+	/// Whether the humidity sensor has been missing too many consecutive samples (and the controller failed over to
+	/// manual mode).
+	/// \return True if stale
+	[[nodiscard]] bool isSensorStale() const;
+
+	/// Whether the dead time of the process model (HC_modelL) is longer than the delay line of the Smith predictor
+	/// allows at the current dt, and has been clamped.
+	/// \return True if clamped
+	[[nodiscard]] bool isDeadTimeClamped() const;
+
+	/// Get the estimated humidity (as of the last update()). Equal to the process variable if the estimator is
+	/// disabled.
+	/// \return Relative humidity (percent)
+	double getEstimate() const;
+
+	/// Get the innovation statistics of the estimator (as of the last update()).
+	/// \param innovation Last innovation (percentage points)
+	/// \param nis        Average normalised innovation squared
+	void getInnovation(double &innovation, double &nis) const;
+
+	/// Start autotuning the humidity control loop using a relay experiment around the current setpoint. When finished,
+	/// the tuned gains are written into the ConfigStore.
+	void startAutotune();
+
 	double getCvMin() const;
 	double getCvMax() const;
 };
@@ -0,0 +1,55 @@
+#include <math.h>
+
+#include CONFIG_HEADER
+#include "HumidityEstimator.h"
+
+void HumidityEstimator::predict(uint16_t dt) {
+	P += config::KF_processNoise * dt / 1000;
+}
+
+void HumidityEstimator::predict(uint16_t dt, double wetFlow, double dryFlow) {
+	// Without inflow, fall back to the random walk model
+	double totalFlow = wetFlow + dryFlow;
+	if (!(totalFlow > 0)) {
+		predict(dt);
+		return;
+	}
+
+	// Humidity of the inflowing mixture, and time constant of the chamber (in s)
+	double inflowHumidity = (wetFlow * config::KF_wetHumidity + dryFlow * config::KF_dryHumidity) / totalFlow;
+	double tau = config::KF_chamberVolume / totalFlow * 60;
+
+	double a = exp(-static_cast<double>(dt) / 1000 / tau);
+	x = a * x + (1 - a) * inflowHumidity;
+	P = a * a * P + config::KF_processNoise * dt / 1000;
+}
+
+void HumidityEstimator::correct(double z) {
+	if (!initialised) {
+		x = z;
+		P = config::KF_measurementNoise;
+		initialised = true;
+		return;
+	}
+
+	innovation = z - x;
+	double S = P + config::KF_measurementNoise; // Innovation variance
+	double K = P / S;                            // Kalman gain
+
+	x += K * innovation;
+	P *= 1 - K;
+
+	nis += config::KF_nisSmoothing * (innovation * innovation / S - nis);
+}
+
+double HumidityEstimator::getEstimate() const {
+	return x;
+}
+
+double HumidityEstimator::getInnovation() const {
+	return innovation;
+}
+
+double HumidityEstimator::getNIS() const {
+	return nis;
+}
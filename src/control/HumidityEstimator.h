@@ -0,0 +1,52 @@
+#ifndef HUMIDISTAT_HUMIDITYESTIMATOR_H
+#define HUMIDISTAT_HUMIDITYESTIMATOR_H
+
+#include <stdint.h>
+
+/// Scalar Kalman filter estimating the chamber humidity.
+/// The prediction step uses a mixing model if the inflows are known (cascade controller): the chamber humidity relaxes
+/// towards the humidity of the inflowing mixture, with a time constant given by the chamber volume divided by the total
+/// flowrate. Otherwise, a random walk model is used. The correction step is run whenever a new sample from the
+/// humidity sensor is available, so the estimate bridges the interval between (and dropouts of) samples. With the
+/// mixing model, the prediction step can run at a higher rate than the samples (the cascade controller runs it at the
+/// rate of its flow controllers).
+class HumidityEstimator {
+private:
+	double x = 0;              //!< Estimate (RH, in percent)
+	double P = 0;              //!< Variance of the estimate
+	bool initialised = false;  //!< Whether the estimate has been initialised with a measurement
+
+	double innovation = 0;     //!< Last innovation (measurement minus prediction)
+	double nis = 0;            //!< Exponentially weighted average of the normalised innovation squared
+
+public:
+	/// Run the prediction step using the random walk model.
+	/// \param dt Timestep (in ms)
+	void predict(uint16_t dt);
+
+	/// Run the prediction step using the mixing model.
+	/// \param dt        Timestep (in ms)
+	/// \param wetFlow   Flowrate of the wet line (L/min)
+	/// \param dryFlow   Flowrate of the dry line (L/min)
+	void predict(uint16_t dt, double wetFlow, double dryFlow);
+
+	/// Run the correction step with a new measurement.
+	/// \param z Measured humidity (RH, in percent)
+	void correct(double z);
+
+	/// Get the estimate.
+	/// \return Estimated humidity (RH, in percent)
+	[[nodiscard]] double getEstimate() const;
+
+	/// Get the last innovation: the difference between the measurement and the predicted humidity.
+	/// \return Innovation (percentage points)
+	[[nodiscard]] double getInnovation() const;
+
+	/// Get the average normalised innovation squared (NIS). For a consistent filter, this is close to 1: if it is
+	/// (much) larger, the noise variances are too small, if it is smaller, they are too large.
+	/// \return Average NIS
+	[[nodiscard]] double getNIS() const;
+};
+
+
+#endif //HUMIDISTAT_HUMIDITYESTIMATOR_H
@@ -0,0 +1,219 @@
+#ifndef HUMIDISTAT_MPC_H
+#define HUMIDISTAT_MPC_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include CONFIG_HEADER
+
+/// Model predictive controller for the cascade humidistat, choosing the flowrate setpoints of the wet and dry lines
+/// directly.
+/// The chamber is modelled as a mixing volume (see HumidityEstimator), fed through a transport delay (the dead time of
+/// the process model). At every step, the model is linearised around the current humidity and flowrates, and the
+/// flowrates over the horizon are optimised for tracking the setpoint, while keeping the total flowrate close to its
+/// nominal value and penalising changes. This box-constrained quadratic program is solved with a fixed number of
+/// iterations of the fast (accelerated) projected gradient method, so the solve time is bounded. Only the first step is
+/// applied. All memory is static.
+///
+/// The runtime of a step does not depend on the state: the solve takes O(N^2) operations per iteration, the setup
+/// O(N^3) (with a small constant) plus O(length) for the inputs in transit.
+/// \tparam N      Horizon (in steps)
+/// \tparam length Maximum transport delay (in steps), which is also the length of the input history
+template<uint8_t N, uint8_t length>
+class MPC {
+private:
+	static_assert(N >= 1 && N <= 127, "The horizon must be 1 to 127 steps");
+	static_assert(length >= 1, "The input history must hold at least 1 step");
+
+	static constexpr uint8_t n = 2 * N; //!< Number of variables: wet and dry flowrate per step
+
+	double H[n][n]; //!< Hessian of the quadratic program
+	double g[n];    //!< Linear term of the quadratic program
+	double z[n];    //!< Flowrates over the horizon (wet, dry, wet, dry, ...), kept as warm start for the next step
+
+	double history[length][2]; //!< Flowrates applied in the past steps (wet, dry)
+	uint8_t head = 0;          //!< Index of the newest entry in the history
+	uint8_t delay = 0;         //!< Transport delay (in steps)
+
+	/// Set up the quadratic program.
+	/// \param x       Humidity (RH, in percent)
+	/// \param sp      Setpoint (RH, in percent)
+	/// \param wetFlow Flowrate of the wet line (L/min)
+	/// \param dryFlow Flowrate of the dry line (L/min)
+	/// \param total   Nominal total flowrate (L/min)
+	void setup(double x, double sp, double wetFlow, double dryFlow, double total);
+
+	/// Solve the quadratic program, starting from (and writing into) z.
+	/// \param maxFlow Upper bound for the flowrates (L/min)
+	void solve(double maxFlow);
+
+public:
+	/// Set the transport delay, limited to MPC_maxDelay steps.
+	/// \param L Dead time (in s)
+	void setDelay(double L);
+
+	/// Reset the controller to steady state at the given flowrates.
+	/// \param wetFlow Flowrate of the wet line (L/min)
+	/// \param dryFlow Flowrate of the dry line (L/min)
+	void reset(double wetFlow, double dryFlow);
+
+	/// Run a step: compute the flowrate setpoints. Call this every MPC_dt.
+	/// \param x       Humidity (RH, in percent)
+	/// \param sp      Setpoint (RH, in percent)
+	/// \param wetFlow Flowrate of the wet line (L/min)
+	/// \param dryFlow Flowrate of the dry line (L/min)
+	/// \param total   Nominal total flowrate (L/min), which is also the upper bound for each line
+	/// \param wetSP   Flowrate setpoint of the wet line (L/min)
+	/// \param drySP   Flowrate setpoint of the dry line (L/min)
+	void step(double x, double sp, double wetFlow, double dryFlow, double total, double &wetSP, double &drySP);
+};
+
+template<uint8_t N, uint8_t length>
+void MPC<N, length>::setDelay(double L) {
+	double steps = round(L * 1000 / config::MPC_dt);
+	if (steps < 0)
+		steps = 0;
+	if (steps > length)
+		steps = length;
+	delay = static_cast<uint8_t>(steps);
+}
+
+template<uint8_t N, uint8_t length>
+void MPC<N, length>::reset(double wetFlow, double dryFlow) {
+	for (auto &flows : history) {
+		flows[0] = wetFlow;
+		flows[1] = dryFlow;
+	}
+	for (uint8_t i = 0; i < N; i++) {
+		z[2 * i] = wetFlow;
+		z[2 * i + 1] = dryFlow;
+	}
+}
+
+template<uint8_t N, uint8_t length>
+void MPC<N, length>::step(double x, double sp, double wetFlow, double dryFlow, double total, double &wetSP,
+                          double &drySP) {
+	setup(x, sp, wetFlow, dryFlow, total);
+
+	// Warm start from the previous solution, shifted by one step
+	for (uint8_t i = 0; i < n - 2; i++)
+		z[i] = z[i + 2];
+
+	solve(total);
+
+	wetSP = z[0];
+	drySP = z[1];
+
+	head = (head + 1) % length;
+	history[head][0] = wetSP;
+	history[head][1] = drySP;
+}
+
+template<uint8_t N, uint8_t length>
+void MPC<N, length>::setup(double x, double sp, double wetFlow, double dryFlow, double total) {
+	// Mixing model, linearised around the current humidity and flowrates: dx/dt = alpha (x - x0) + beta . u,
+	// discretised with zero-order hold: e[k+1] = A e[k] + B . u[k], with e the deviation from the current humidity
+	double Ts = config::MPC_dt / 1000.;
+	double volume = config::KF_chamberVolume * 60; // In L s/min, so that flowrates in L/min give rates in 1/s
+	double alpha = -(wetFlow + dryFlow) / volume;
+	double A = exp(alpha * Ts);
+	double phi = alpha < 0 ? (A - 1) / alpha : Ts;
+	double B[2] = {phi * (config::KF_wetHumidity - x) / volume, phi * (config::KF_dryHumidity - x) / volume};
+
+	// Free response: propagate the inputs that are still in transit, then no input
+	double e = 0;
+	for (uint8_t k = delay; k > 0; k--) {
+		const double *u = history[(head + length + 1 - k) % length];
+		e = A * e + B[0] * u[0] + B[1] * u[1];
+	}
+	double f[N]; // Free response minus reference
+	for (double &fj : f) {
+		e *= A;
+		fj = e - (sp - x);
+	}
+
+	// Powers of A
+	double pow[N];
+	pow[0] = 1;
+	for (uint8_t j = 1; j < N; j++)
+		pow[j] = pow[j - 1] * A;
+
+	// The predicted deviation at step j (after the delay) is f[j] + sum_{i <= j} A^(j - i) B . u[i]
+	for (uint8_t i = 0; i < N; i++) {
+		for (uint8_t k = i; k < N; k++) {
+			// Sum over the prediction steps affected by both u[i] and u[k]
+			double m = 0;
+			for (uint8_t j = k; j < N; j++)
+				m += pow[j - i] * pow[j - k];
+
+			for (uint8_t a = 0; a < 2; a++) {
+				for (uint8_t b = 0; b < 2; b++) {
+					double h = B[a] * B[b] * m;
+					if (i == k)
+						h += config::MPC_totalWeight;
+					if (i == k && a == b)
+						h += config::MPC_moveWeight * (i < N - 1 ? 2 : 1);
+					if (k == i + 1 && a == b)
+						h -= config::MPC_moveWeight;
+					H[2 * i + a][2 * k + b] = h;
+					H[2 * k + b][2 * i + a] = h;
+				}
+			}
+		}
+
+		double c = 0;
+		for (uint8_t j = i; j < N; j++)
+			c += pow[j - i] * f[j];
+		for (uint8_t a = 0; a < 2; a++)
+			g[2 * i + a] = B[a] * c - config::MPC_totalWeight * total;
+	}
+
+	// Penalise the change from the last applied flowrates
+	g[0] -= config::MPC_moveWeight * history[head][0];
+	g[1] -= config::MPC_moveWeight * history[head][1];
+}
+
+template<uint8_t N, uint8_t length>
+void MPC<N, length>::solve(double maxFlow) {
+	// Step size: the inverse of an upper bound of the largest eigenvalue of H (Gershgorin)
+	double L = 0;
+	for (auto &row : H) {
+		double sum = 0;
+		for (double h : row)
+			sum += fabs(h);
+		if (sum > L)
+			L = sum;
+	}
+
+	double y[n], zLast[n];
+	for (uint8_t i = 0; i < n; i++)
+		y[i] = zLast[i] = z[i];
+
+	double t = 1;
+	for (uint8_t it = 0; it < config::MPC_iterations; it++) {
+		// Projected gradient step from y
+		for (uint8_t i = 0; i < n; i++) {
+			double grad = g[i];
+			for (uint8_t k = 0; k < n; k++)
+				grad += H[i][k] * y[k];
+
+			double zi = y[i] - grad / L;
+			if (zi < 0)
+				zi = 0;
+			if (zi > maxFlow)
+				zi = maxFlow;
+			z[i] = zi;
+		}
+
+		// Momentum
+		double tNext = (1 + sqrt(1 + 4 * t * t)) / 2;
+		double beta = (t - 1) / tNext;
+		for (uint8_t i = 0; i < n; i++) {
+			y[i] = z[i] + beta * (z[i] - zLast[i]);
+			zLast[i] = z[i];
+		}
+		t = tNext;
+	}
+}
+
+#endif //HUMIDISTAT_MPC_H
@@ -1,37 +1,70 @@
 #ifndef HUMIDISTAT_PID_H
 #define HUMIDISTAT_PID_H
 
+#include <math.h>
 #include <stdint.h>
 
-/// PID controller in parallel form implemented in floating-point arithmetic. Features Derivative-on-Measurement,
-/// anti-windup through conditional integration, bumpless transfer, and feed-forward.
+#include "PIDGains.h"
+
+/// PID controller in parallel form. Features setpoint weighting for the proportional and derivative terms (with b = 1
+/// and c = 0, i.e. Derivative-on-Measurement, by default), anti-windup through conditional integration or
+/// back-calculation (optionally tracking an external signal), bumpless transfer, and feed-forward (proportional to the
+/// setpoint, and/or external). The derivative is low-pass filtered (first or second order), with a time constant in
+/// seconds, so that the filter bandwidth does not depend on the timestep.
+/// The interface is in double; internally, the arithmetic is done in the type given by Scalar.
+/// \tparam Scalar Either double (floating-point) or q16_16 (fixed-point)
+/// \tparam Gains  Either RuntimeGains (tunable) or StaticGains (compile-time constant)
+template<typename Scalar, class Gains = RuntimeGains<Scalar>>
 class PID {
+public:
+	using Signal = typename PIDTypes<Scalar>::Signal;
+	using Output = typename PIDTypes<Scalar>::Output;
+
 private:
 	const double &pv; //!< Process variable
 	double &cv;       //!< Control variable
 	const double &sp; //!< Setpoint
 
-	double Kp, Ki, Kd, Kf; //!< Gains
-	double a;              //!< Smoothing factor for EWA filter for derivative
-	uint16_t dt;           //!< Timestep
+	Gains gains;          //!< Gains and timestep
+	double Tf;            //!< Time constant of the derivative filter (in s)
+	uint8_t filterOrder;  //!< Order of the derivative filter (1 or 2)
+	Output alpha;         //!< Smoothing factor of each first-order section of the derivative filter
+	Output b = Output(1); //!< Setpoint weight for the proportional term
+	Output c = Output(0); //!< Setpoint weight for the derivative term
+	Output ff{};          //!< External feed-forward
+	bool spFF = true;     //!< Whether the feed-forward on the setpoint (Kf * sp) is enabled
+
+	double Tt = 0;          //!< Tracking time constant for back-calculation (in s), or 0 for conditional integration
+	Output Kt{};            //!< Tracking gain (with the timestep included)
+	bool tracking = false;  //!< Whether the integral tracks the external tracking input
+	Output trackingInput{}; //!< External tracking input
 
 	bool inAuto = false; //!< Mode
-	double lastPv;       //!< Last value of pv
-	double lastE;        //!< Last value of error
-	double lastDPV;        //!< Last value of derivative term
-	double integral;     //!< Integral of pv
+	Signal lastY;        //!< Last value of the weighted measurement for the derivative (pv - c*sp)
+	Signal lastE;        //!< Last value of error
+	Signal lastDY;       //!< Last value of derivative of the weighted measurement (filtered)
+	Signal lastDY1;      //!< Last output of the first section of the derivative filter (if second order)
+	Output integral;     //!< Integral of error, multiplied by Ki
 
 	/// Method to be called when the controller goes from manual to auto mode for proper bumpless transfer.
 	void init();
 
+	/// Update the tracking gain and the derivative filter coefficient from their time constants and the timestep.
+	void updateCoefficients();
+
+	/// Get the feed-forward on the setpoint.
+	/// \param sp Setpoint
+	/// \return Kf * sp, or 0 if disabled
+	Output setpointFeedForward(Signal sp) const;
+
 	/// Clip value to [cvMin, cvMax].
 	/// \param value Value to clip
 	/// \return Clipped value
-	double clip(double value) const;
+	Output clip(Output value) const;
 
 public:
-	double pTerm = 0, iTerm = 0, dTerm = 0, fTerm = 0; //!< PID terms
-	double cvMin, cvMax;                    //!< Lower/upper limits for cv
+	Output pTerm{}, iTerm{}, dTerm{}, fTerm{}; //!< PID terms
+	Output cvMin, cvMax;                       //!< Lower/upper limits for cv
 
 	/// Constructor.
 	/// \param pv Pointer to process variable
@@ -44,9 +77,10 @@ public:
 	/// \param dt Timestep (in ms)
 	/// \param cvMin Lower limit for control value
 	/// \param cvMax Upper limit for control value
-	/// \param a Smoothing factor for EWA filter for derivative
+	/// \param Tf Time constant of the derivative filter (in s)
+	/// \param filterOrder Order of the derivative filter (1 or 2)
 	PID(const double *pv, double *cv, const double *sp, double Kp, double Ki, double Kd, double Kf, uint16_t dt,
-	    double cvMin, double cvMax, double a);
+	    double cvMin, double cvMax, double Tf, uint8_t filterOrder = 1);
 
 	/// Run a cycle of the PID loop.
 	/// \return True if a PID step was run, and false if not.
@@ -56,13 +90,249 @@ public:
 	/// \param inAuto Set to true for automatic, false for manual.
 	void setAuto(bool inAuto);
 
-	/// Set the gains and timestep.
+	/// Set the gains and timestep. Has no effect if the gains are compile-time constants.
 	/// \param Kp Proportional gain
 	/// \param Ki Integral gain (in 1/s)
 	/// \param Kd Derivative gain (in s)
 	/// \param Kf Feed-forward gain
 	/// \param dt Timestep (in ms)
 	void setGains(double Kp, double Ki, double Kd, double Kf, uint16_t dt);
+
+	/// Change the gains and timestep while running, without bumping the output: the integral is adjusted to compensate
+	/// for the change in the proportional, derivative and feed-forward terms (as of the last cycle). Suitable for gain
+	/// scheduling. Has no effect if the gains are compile-time constants.
+	/// \param Kp Proportional gain
+	/// \param Ki Integral gain (in 1/s)
+	/// \param Kd Derivative gain (in s)
+	/// \param Kf Feed-forward gain
+	/// \param dt Timestep (in ms)
+	void setGainsBumpless(double Kp, double Ki, double Kd, double Kf, uint16_t dt);
+
+	/// Set the setpoint weights. Lowering b reduces the proportional kick (and overshoot) on setpoint changes, without
+	/// affecting the response to disturbances. With c = 0, the derivative term does not respond to setpoint changes at
+	/// all (Derivative-on-Measurement).
+	/// \param b Setpoint weight for the proportional term
+	/// \param c Setpoint weight for the derivative term
+	void setWeights(double b, double c);
+
+	/// Set the external feed-forward, which is added to the output. The integral term then only has to correct for the
+	/// residual error. Changes take effect immediately (also in auto mode).
+	/// \param ff External feed-forward
+	void setFeedForward(double ff);
+
+	/// Enable or disable the feed-forward on the setpoint (Kf * sp). Disable it when the external feed-forward already
+	/// gives the steady-state output for the setpoint, or the two would count it twice.
+	/// \param enabled Whether to add Kf * sp to the output
+	void setSetpointFeedForward(bool enabled);
+
+	/// Set the tracking time constant for anti-windup through back-calculation: the integral is bled towards the
+	/// actual output (the clipped output, or the tracking input) with this time constant. A rule of thumb is to use the
+	/// integral time (Kp/Ki). Set to 0 to use conditional integration instead.
+	/// \param Tt Tracking time constant (in s)
+	void setTrackingTime(double Tt);
+
+	/// Set the external tracking input (only effective with back-calculation). When enabled, the integral tracks the
+	/// given signal instead of the clipped output, e.g. the output actually realised by a saturated inner loop.
+	/// \param enabled Whether to track the input
+	/// \param input   Tracking input (in units of cv)
+	void setTracking(bool enabled, double input = 0);
+
+	/// Set the derivative filter. With a second-order filter, two first-order sections with time constant Tf/2 are
+	/// cascaded (for about the same delay, but a steeper roll-off). The filter is discretised exactly for the timestep.
+	/// \param Tf          Time constant (in s), or 0 for no filtering
+	/// \param filterOrder Order (1 or 2)
+	void setDerivativeFilter(double Tf, uint8_t filterOrder);
+
+	/// Set the limits for cv.
+	/// \param cvMin Lower limit for control value
+	/// \param cvMax Upper limit for control value
+	void setCvLimits(double cvMin, double cvMax);
 };
 
+template<typename Scalar, class Gains>
+PID<Scalar, Gains>::PID(const double *pv, double *cv, const double *sp, double Kp, double Ki, double Kd, double Kf,
+                 uint16_t dt, double cvMin, double cvMax, double Tf, uint8_t filterOrder)
+	: pv(*pv), cv(*cv), sp(*sp), Tf(Tf), filterOrder(filterOrder), cvMin(cvMin), cvMax(cvMax) {
+	setGains(Kp, Ki, Kd, Kf, dt);
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::init() {
+	Signal sp(this->sp), pv(this->pv);
+
+	if (gains.hasI && gains.Ki != Output(0))
+		integral = Output(cv) - setpointFeedForward(sp) - ff;
+	else
+		integral = Output(0);
+	lastY = pv - sp * c;
+	lastE = sp - pv;
+
+	// Start the derivative filter at rest, rather than from its state before the manual period
+	lastDY = Signal(0);
+	lastDY1 = Signal(0);
+}
+
+template<typename Scalar, class Gains>
+bool PID<Scalar, Gains>::compute() {
+	// Terminate if not in auto
+	if (!inAuto)
+		return false;
+
+	Signal sp = ScalarCast<Signal>::from(this->sp), pv = ScalarCast<Signal>::from(this->pv);
+	Output cv = ScalarCast<Output>::from(this->cv);
+
+	// Proportional (on setpoint-weighted error)
+	pTerm = gains.Kp * (sp * b - pv);
+	Output u = pTerm;
+
+	if constexpr (Gains::hasI) {
+		// Integral error
+		Signal e = sp - pv;
+		Signal delta = (lastE + e) / 2; // Trapezoidal integration
+		// Anti-windup through back-calculation (below), or else conditional integration
+		if (Kt != Output(0) || ((cv < cvMax || delta < Signal(0)) && (cv > cvMin || delta > Signal(0))))
+			integral += gains.Ki * delta;
+
+		iTerm = integral;
+		u += iTerm;
+		lastE = e;
+	}
+
+	if constexpr (Gains::hasD) {
+		// Derivative (on setpoint-weighted measurement)
+		Signal y = pv - sp * c;
+		// Backwards difference, low-pass filtered by one or two first-order sections
+		Signal dY = (filterOrder == 2 ? lastDY1 : lastDY) * (Output(1) - alpha) + (y - lastY) * alpha;
+		if (filterOrder == 2) {
+			lastDY1 = dY;
+			dY = lastDY * (Output(1) - alpha) + dY * alpha;
+		}
+
+		dTerm = -gains.Kd * dY;
+		u += dTerm;
+		lastY = y;
+		lastDY = dY;
+	}
+
+	// Feed-forward (on setpoint, and external)
+	fTerm = ff + setpointFeedForward(sp);
+	u += fTerm;
+
+	Output v = clip(u);
+	this->cv = ScalarCast<Output>::to(v);
+
+	if constexpr (Gains::hasI) {
+		// Anti-windup through back-calculation: bleed the integral towards the actual (clipped or tracked) output
+		if (Kt != Output(0))
+			integral += Kt * ((tracking ? trackingInput : v) - u);
+	}
+
+	return true;
+}
+
+template<typename Scalar, class Gains>
+typename PID<Scalar, Gains>::Output PID<Scalar, Gains>::clip(Output value) const {
+	if (value > cvMax)
+		return cvMax;
+	if (value < cvMin)
+		return cvMin;
+	return value;
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::setAuto(bool inAuto) {
+	// When going from manual to auto, run init() for bumpless transfer
+	if (inAuto && !this->inAuto)
+		init();
+	this->inAuto = inAuto;
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::setGains(double Kp, double Ki, double Kd, double Kf, uint16_t dt) {
+	gains.set(Kp, Ki, Kd, Kf, dt);
+	updateCoefficients();
+	init();
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::setGainsBumpless(double Kp, double Ki, double Kd, double Kf, uint16_t dt) {
+	// Without integral action, there is nothing to compensate with
+	if (!inAuto || !gains.hasI || gains.Ki == Output(0)) {
+		setGains(Kp, Ki, Kd, Kf, dt);
+		return;
+	}
+
+	Signal sp(this->sp), pv(this->pv);
+	Signal eP = sp * b - pv;
+	Output before = gains.Kp * eP - gains.Kd * lastDY + setpointFeedForward(sp);
+	// The coefficients only depend on the timestep: with gain scheduling, this runs every cycle, so skip the exp()
+	bool dtChanged = dt != gains.dt;
+	gains.set(Kp, Ki, Kd, Kf, dt);
+	if (dtChanged)
+		updateCoefficients();
+	Output after = gains.Kp * eP - gains.Kd * lastDY + setpointFeedForward(sp);
+
+	integral += before - after;
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::setWeights(double b, double c) {
+	this->b = Output(b);
+	this->c = Output(c);
+	init();
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::setTrackingTime(double Tt) {
+	this->Tt = Tt;
+	updateCoefficients();
+	init();
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::setDerivativeFilter(double Tf, uint8_t filterOrder) {
+	this->Tf = Tf;
+	this->filterOrder = filterOrder;
+	updateCoefficients();
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::updateCoefficients() {
+	double dt = static_cast<double>(gains.dt) / 1000;
+	Kt = Tt > 0 ? Output(dt / Tt) : Output(0);
+	alpha = Tf > 0 ? Output(1 - exp(-dt * filterOrder / Tf)) : Output(1);
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::setTracking(bool enabled, double input) {
+	tracking = enabled;
+	trackingInput = Output(input);
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::setFeedForward(double ff) {
+	this->ff = Output(ff);
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::setSetpointFeedForward(bool enabled) {
+	spFF = enabled;
+	init();
+}
+
+template<typename Scalar, class Gains>
+typename PID<Scalar, Gains>::Output PID<Scalar, Gains>::setpointFeedForward(Signal sp) const {
+	if constexpr (Gains::hasF) {
+		if (spFF)
+			return gains.Kf * sp;
+	}
+	return Output(0);
+}
+
+template<typename Scalar, class Gains>
+void PID<Scalar, Gains>::setCvLimits(double cvMin, double cvMax) {
+	this->cvMin = Output(cvMin);
+	this->cvMax = Output(cvMax);
+}
+
 #endif //HUMIDISTAT_PID_H
@@ -0,0 +1,92 @@
+#ifndef HUMIDISTAT_PIDGAINS_H
+#define HUMIDISTAT_PIDGAINS_H
+
+#include <stdint.h>
+
+#include "../Fixed.h"
+
+/// Types used for the internal arithmetic of a PID controller.
+/// By default, a single type is used for both the (input) signals and the gains/(output) terms.
+/// \tparam Scalar Arithmetic type
+template<typename Scalar>
+struct PIDTypes {
+	using Signal = Scalar; //!< Type of pv, sp and derived quantities
+	using Output = Scalar; //!< Type of cv, the gains and the PID terms
+};
+
+/// For fixed-point arithmetic, the signals (humidities, flowrates) are stored in Q16.16 in order to have sufficient
+/// range, while the (normalised) CV, the PID terms and the gains are stored in Q8.24 in order to have sufficient
+/// resolution for small integral gains.
+template<>
+struct PIDTypes<q16_16> {
+	using Signal = q16_16;
+	using Output = q8_24;
+};
+
+/// PID gains and timestep that can be set at run-time.
+/// \tparam Scalar Either double (floating-point) or q16_16 (fixed-point)
+template<typename Scalar>
+class RuntimeGains {
+private:
+	using Output = typename PIDTypes<Scalar>::Output;
+
+public:
+	///@{
+	/// Whether the I/D/F terms are used. Unknown at compile time, so always true.
+	static constexpr bool hasI = true;
+	static constexpr bool hasD = true;
+	static constexpr bool hasF = true;
+	///@}
+
+	Output Kp, Ki, Kd, Kf; //!< Gains (with the timestep included in Ki and Kd)
+	uint16_t dt;           //!< Timestep (in ms)
+
+	/// Set the gains and timestep.
+	/// \param Kp Proportional gain
+	/// \param Ki Integral gain (in 1/s)
+	/// \param Kd Derivative gain (in s)
+	/// \param Kf Feed-forward gain
+	/// \param dt Timestep (in ms)
+	void set(double Kp, double Ki, double Kd, double Kf, uint16_t dt) {
+		this->dt = dt;
+		this->Kp = Output(Kp);
+
+		// The timestep is constant, so we include it in Ki and Kd for convenience
+		this->Ki = Output(Ki * dt / 1000);
+		this->Kd = Output(Kd / (static_cast<double>(dt) / 1000));
+
+		this->Kf = Output(Kf);
+	}
+};
+
+/// PID gains and timestep that are fixed at compile time. This allows the compiler to fold the constants, and to strip
+/// the I/D/F terms completely if their gain is zero.
+/// \tparam Scalar    Either double (floating-point) or q16_16 (fixed-point)
+/// \tparam Constants Struct with static constexpr members Kp, Ki (in 1/s), Kd (in s), Kf, and dt (in ms)
+template<typename Scalar, class Constants>
+class StaticGains {
+private:
+	using Output = typename PIDTypes<Scalar>::Output;
+
+public:
+	///@{
+	/// Whether the I/D/F terms are used.
+	static constexpr bool hasI = Constants::Ki != 0;
+	static constexpr bool hasD = Constants::Kd != 0;
+	static constexpr bool hasF = Constants::Kf != 0;
+	///@}
+
+	///@{
+	/// Gains (with the timestep included in Ki and Kd)
+	static constexpr Output Kp = Output(Constants::Kp);
+	static constexpr Output Ki = Output(Constants::Ki * Constants::dt / 1000);
+	static constexpr Output Kd = Output(Constants::Kd / (static_cast<double>(Constants::dt) / 1000));
+	static constexpr Output Kf = Output(Constants::Kf);
+	///@}
+	static constexpr uint16_t dt = Constants::dt; //!< Timestep (in ms)
+
+	/// The gains are fixed, so this does nothing.
+	void set(double, double, double, double, uint16_t) {}
+};
+
+#endif //HUMIDISTAT_PIDGAINS_H
@@ -0,0 +1,96 @@
+#include <math.h>
+
+#include "RelayAutotuner.h"
+
+void RelayAutotuner::start(double sp, double bias, double d, double eps, uint16_t dt, uint8_t nPeriods,
+                           uint16_t timeout) {
+	this->sp = sp;
+	this->bias = bias;
+	this->d = d;
+	this->eps = eps;
+	this->dt = dt;
+	this->nPeriods = nPeriods;
+	maxSteps = static_cast<uint32_t>(timeout) * 1000 / dt;
+
+	steps = 0;
+	high = true;
+	lastRise = 0;
+	pvMax = -INFINITY;
+	pvMin = INFINITY;
+	periods = 0;
+	sumAmplitude = 0;
+	sumPeriod = 0;
+
+	state = State::running;
+}
+
+double RelayAutotuner::step(double pv) {
+	if (state != State::running)
+		return bias;
+
+	if (++steps > maxSteps) {
+		state = State::failed;
+		return bias;
+	}
+
+	if (pv > pvMax)
+		pvMax = pv;
+	if (pv < pvMin)
+		pvMin = pv;
+
+	if (high && pv > sp + eps) {
+		high = false;
+	} else if (!high && pv < sp - eps) {
+		// A rising switch completes a period
+		high = true;
+
+		// Discard the first (transient) period
+		if (periods > 0) {
+			sumAmplitude += (pvMax - pvMin) / 2;
+			sumPeriod += steps - lastRise;
+		}
+		periods++;
+		lastRise = steps;
+		pvMax = -INFINITY;
+		pvMin = INFINITY;
+
+		if (periods > nPeriods)
+			finish();
+	}
+
+	return high ? bias + d : bias - d;
+}
+
+void RelayAutotuner::finish() {
+	double a = sumAmplitude / nPeriods;
+
+	// Describing function of a relay with hysteresis
+	Ku = 4 * d / (M_PI * sqrt(a > eps ? a * a - eps * eps : a * a));
+	Tu = static_cast<double>(sumPeriod) / nPeriods * dt / 1000;
+
+	state = State::done;
+}
+
+RelayAutotuner::State RelayAutotuner::getState() const {
+	return state;
+}
+
+bool RelayAutotuner::isRunning() const {
+	return state == State::running;
+}
+
+void RelayAutotuner::reset() {
+	state = State::idle;
+}
+
+void RelayAutotuner::getGains(double &Kp, double &Ki, double &Kd, bool withD) const {
+	if (withD) {
+		Kp = Ku / 2.2;
+		Ki = Kp / (2.2 * Tu);
+		Kd = Kp * Tu / 6.3;
+	} else {
+		Kp = Ku / 3.2;
+		Ki = Kp / (2.2 * Tu);
+		Kd = 0;
+	}
+}
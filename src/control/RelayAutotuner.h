@@ -0,0 +1,80 @@
+#ifndef HUMIDISTAT_RELAYAUTOTUNER_H
+#define HUMIDISTAT_RELAYAUTOTUNER_H
+
+#include <stdint.h>
+
+/// Relay (Åström–Hägglund) autotuner.
+/// Drives the control variable as a relay with hysteresis around a bias value, which makes the loop oscillate. From
+/// the amplitude and period of the oscillation in the process variable, the ultimate gain and period are
+/// estimated, from which PID gains are calculated using the Tyreus–Luyben rules.
+class RelayAutotuner {
+public:
+	enum class State : uint8_t {
+		idle,
+		running,
+		done,
+		failed,
+	};
+
+private:
+	volatile State state = State::idle;
+
+	double sp;         //!< Setpoint around which to oscillate
+	double bias;       //!< Centre value of the relay output
+	double d;          //!< Relay amplitude
+	double eps;        //!< Hysteresis
+	uint16_t dt;       //!< Timestep (in ms)
+	uint32_t steps;    //!< Number of steps since start
+	uint32_t maxSteps; //!< Number of steps after which to give up
+
+	bool high;           //!< Relay output state
+	uint32_t lastRise;   //!< Step at which the relay last switched to high
+	double pvMax, pvMin; //!< Extremes of pv in the current period
+	uint8_t periods;     //!< Number of completed periods (the first one is discarded as transient)
+	uint8_t nPeriods;    //!< Number of periods to average over
+	double sumAmplitude; //!< Sum of amplitudes of the completed periods
+	uint32_t sumPeriod;  //!< Sum of the lengths (in steps) of the completed periods
+
+	double Ku = 0; //!< Ultimate gain
+	double Tu = 0; //!< Ultimate period (in s)
+
+	/// Finish the experiment: calculate Ku and Tu.
+	void finish();
+
+public:
+	/// Start the relay experiment.
+	/// \param sp       Setpoint around which to oscillate
+	/// \param bias     Centre value of the relay output
+	/// \param d        Relay amplitude
+	/// \param eps      Hysteresis (in units of the process variable)
+	/// \param dt       Timestep (in ms)
+	/// \param nPeriods Number of periods to average over
+	/// \param timeout  Time after which to give up (in s)
+	void start(double sp, double bias, double d, double eps, uint16_t dt, uint8_t nPeriods, uint16_t timeout);
+
+	/// Run a step of the relay experiment. Call this every timestep instead of computing the PID.
+	/// \param pv Process variable
+	/// \return Control variable
+	double step(double pv);
+
+	/// Get the state of the experiment.
+	/// \return state
+	[[nodiscard]] State getState() const;
+
+	/// Whether the experiment is running.
+	/// \return True if running
+	[[nodiscard]] bool isRunning() const;
+
+	/// Set the state back to idle, after the result has been processed.
+	void reset();
+
+	/// Calculate PID gains from the result using the Tyreus–Luyben rules. Only valid if the state is done.
+	/// \param Kp       Proportional gain
+	/// \param Ki       Integral gain (in 1/s)
+	/// \param Kd       Derivative gain (in s)
+	/// \param withD    True for PID gains, false for PI gains (Kd = 0)
+	void getGains(double &Kp, double &Ki, double &Kd, bool withD) const;
+};
+
+
+#endif //HUMIDISTAT_RELAYAUTOTUNER_H
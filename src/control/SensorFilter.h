@@ -0,0 +1,139 @@
+#ifndef HUMIDISTAT_SENSORFILTER_H
+#define HUMIDISTAT_SENSORFILTER_H
+
+#include <stdint.h>
+#include <math.h>
+
+/// Pre-filter for the samples of a sensor, placed between the sensor and the process variable of a controller.
+/// Rejects outliers with a Hampel filter over a sliding window: a sample that deviates from the median of the window by
+/// more than a threshold times the (scaled) median absolute deviation is replaced by the median. The deviation is
+/// floored at the resolution of the sensor: with quantised samples, most of the window often reads the same value, so
+/// that the median absolute deviation is 0, and every change of a single step would be rejected. With a threshold of 0,
+/// this is a plain median filter, and with a window of 1 sample, it is bypassed. Optionally, the rate of change of the
+/// output is limited. Missing (NaN) samples are skipped, so that the output holds its last value, and counted: after
+/// too many consecutive missing samples, the filter is stale, and the controller should stop relying on it.
+///
+/// The window is a fixed-size ring buffer and the medians are taken by sorting a copy of it, so update() does not
+/// allocate, and its cost only depends on N.
+/// \tparam N Window length (in samples)
+template<uint8_t N>
+class SensorFilter {
+private:
+	static_assert(N >= 1, "The window must hold at least 1 sample");
+
+	const double threshold;   //!< Outlier threshold (in standard deviations)
+	const double resolution;  //!< Resolution of the sensor (in units), the floor of the median absolute deviation
+	const double maxRate;     //!< Rate limit (in units/s), or 0 for none
+	const uint8_t staleLimit; //!< Number of consecutive missing samples after which the filter is stale, or 0 for never
+
+	double window[N]{}; //!< Ring buffer of the last samples
+	uint8_t head = 0;   //!< Index of the next sample in the ring buffer
+	uint8_t count = 0;  //!< Number of samples in the ring buffer
+	double value = NAN; //!< Output
+	uint8_t missed = 0; //!< Number of consecutive missing samples
+	uint16_t rejected = 0;
+
+	/// Take the median of an array by sorting it in place (insertion sort, which is fast for such short arrays).
+	/// \param a Array
+	/// \param n Number of elements (at least 1)
+	/// \return Median
+	static double median(double *a, uint8_t n) {
+		for (uint8_t i = 1; i < n; i++) {
+			double x = a[i];
+			uint8_t j = i;
+			for (; j > 0 && a[j - 1] > x; j--)
+				a[j] = a[j - 1];
+			a[j] = x;
+		}
+		return n % 2 ? a[n / 2] : (a[n / 2 - 1] + a[n / 2]) / 2;
+	}
+
+public:
+	/// Constructor.
+	/// \param threshold  Outlier threshold (in standard deviations, estimated from the median absolute deviation)
+	/// \param resolution Resolution of the sensor (in units)
+	/// \param maxRate    Rate limit (in units/s), or 0 for none
+	/// \param staleLimit Number of consecutive missing samples after which the filter is stale, or 0 for never
+	SensorFilter(double threshold, double resolution, double maxRate, uint8_t staleLimit)
+		: threshold(threshold), resolution(resolution), maxRate(maxRate), staleLimit(staleLimit) {}
+
+	/// Clear the window and the output.
+	void reset() {
+		head = 0;
+		count = 0;
+		value = NAN;
+	}
+
+	/// Pass a sample through the filter.
+	/// \param x  Sample (NaN if missing)
+	/// \param dt Time since the previous sample (in ms)
+	/// \return True if the output was updated, false if the sample was missing
+	bool update(double x, uint16_t dt) {
+		if (isnan(x)) {
+			if (missed < UINT8_MAX)
+				missed++;
+			return false;
+		}
+
+		// Start afresh after an outage, rather than rate-limiting from a value that is long outdated
+		if (isStale())
+			reset();
+		missed = 0;
+
+		window[head] = x;
+		head = (head + 1) % N;
+		if (count < N)
+			count++;
+
+		// Median of the window, and median absolute deviation from it (a window of 1 sample bypasses the filter)
+		if constexpr (N > 1) {
+			double sorted[N];
+			for (uint8_t i = 0; i < count; i++)
+				sorted[i] = window[i];
+			double m = median(sorted, count);
+			for (uint8_t i = 0; i < count; i++)
+				sorted[i] = fabs(window[i] - m);
+			double mad = median(sorted, count);
+			if (mad < resolution)
+				mad = resolution;
+
+			// The MAD times 1.4826 estimates the standard deviation of normally distributed samples
+			if (fabs(x - m) > threshold * 1.4826 * mad) {
+				x = m;
+				rejected++;
+			}
+		}
+
+		if (maxRate > 0 && !isnan(value)) {
+			double step = maxRate * dt / 1000;
+			if (x > value + step)
+				x = value + step;
+			if (x < value - step)
+				x = value - step;
+		}
+
+		value = x;
+		return true;
+	}
+
+	/// Get the output (NaN if no sample has been accepted yet).
+	/// \return Output
+	double getValue() const {
+		return value;
+	}
+
+	/// Whether too many consecutive samples have been missing.
+	/// \return True if stale
+	[[nodiscard]] bool isStale() const {
+		return staleLimit && missed >= staleLimit;
+	}
+
+	/// Get the number of samples that were rejected as outliers (and replaced by the median).
+	/// \return Number of rejected samples
+	[[nodiscard]] uint16_t getRejected() const {
+		return rejected;
+	}
+};
+
+
+#endif //HUMIDISTAT_SENSORFILTER_H
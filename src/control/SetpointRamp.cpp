@@ -0,0 +1,53 @@
+#include <math.h>
+
+#include "SetpointRamp.h"
+
+void SetpointRamp::setLimits(double rate, double accel) {
+	this->rate = rate;
+	this->accel = accel;
+}
+
+void SetpointRamp::reset(double value) {
+	position = value;
+	velocity = 0;
+}
+
+double SetpointRamp::step(double target, uint16_t dt) {
+	double h = static_cast<double>(dt) / 1000;
+	double error = target - position;
+
+	// Without limits, or on the target already, follow the target
+	if ((rate <= 0 && accel <= 0) || error == 0) {
+		velocity = error / h;
+		position = target;
+		return position;
+	}
+
+	// Desired speed: the rate limit, but slow enough to brake in time with the acceleration limit
+	double speed = rate > 0 ? rate : fabs(error) / h;
+	if (accel > 0) {
+		double braking = sqrt(2 * accel * fabs(error));
+		if (braking < speed)
+			speed = braking;
+
+		double desired = error > 0 ? speed : -speed;
+		double dv = desired - velocity;
+		if (dv > accel * h)
+			dv = accel * h;
+		if (dv < -accel * h)
+			dv = -accel * h;
+		velocity += dv;
+	} else {
+		velocity = error > 0 ? speed : -speed;
+	}
+
+	// Land on the target instead of overshooting it
+	double delta = velocity * h;
+	if ((error > 0 && delta >= error) || (error < 0 && delta <= error)) {
+		velocity = error / h;
+		position = target;
+	} else {
+		position += delta;
+	}
+	return position;
+}
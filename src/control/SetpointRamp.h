@@ -0,0 +1,35 @@
+#ifndef HUMIDISTAT_SETPOINTRAMP_H
+#define HUMIDISTAT_SETPOINTRAMP_H
+
+#include <stdint.h>
+
+/// Setpoint trajectory generator.
+/// Moves its output towards a target setpoint with a limited rate, and optionally a limited acceleration (braking in
+/// time to land on the target without overshoot). Placed between the setpoint source and the controller, it prevents
+/// setpoint steps from driving the actuators into saturation.
+class SetpointRamp {
+private:
+	double rate = 0;     //!< Rate limit (in units/s), or 0 for none
+	double accel = 0;    //!< Acceleration limit (in units/s^2), or 0 for none
+	double position = 0; //!< Current output
+	double velocity = 0; //!< Current rate of change of the output (in units/s)
+
+public:
+	/// Set the limits. If both are 0, the output follows the target immediately.
+	/// \param rate  Rate limit (in units/s), or 0 for none
+	/// \param accel Acceleration limit (in units/s^2), or 0 for none
+	void setLimits(double rate, double accel);
+
+	/// Reset the output to the given value, at rest.
+	/// \param value Value
+	void reset(double value);
+
+	/// Advance the output by one timestep towards the target.
+	/// \param target Target setpoint
+	/// \param dt     Timestep (in ms)
+	/// \return Output
+	double step(double target, uint16_t dt);
+};
+
+
+#endif //HUMIDISTAT_SETPOINTRAMP_H
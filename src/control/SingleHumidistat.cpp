@@ -1,22 +1,95 @@
 #include <Arduino.h>
 
 #include "SingleHumidistat.h"
-#include "imath.h"
 
-SingleHumidistat::SingleHumidistat(HumiditySensor *hs, const ConfigStore *cs,  etl::array<uint8_t, 2> pins_solenoid,
-								   uint8_t pwmRes)
-		: Humidistat(cs, hs, cs->HC_Kp, cs->HC_Ki, cs->HC_Kd, cs->HC_Kf, cs->dt, cs->S_lowValue, 1),
-		  pins_solenoid{pins_solenoid[0], pins_solenoid[1]}, pwmRes(pwmRes) {}
+SingleHumidistat::SingleHumidistat(HumiditySensor *hs, ConfigStore *cs,  etl::array<uint8_t, 2> pins_solenoid,
+								   uint8_t pwmRes, uint8_t channel)
+		: Humidistat(cs, hs, cs->HC_Kp, cs->HC_Ki, cs->HC_Kd, cs->HC_Kf, cs->dt, solenoidCvMin(*cs), 1, channel),
+		  solenoids{Solenoid(pins_solenoid[0], pwmRes, config::valveLinearization ? &cs->S_valveTables[0] : nullptr),
+		            Solenoid(pins_solenoid[1], pwmRes, config::valveLinearization ? &cs->S_valveTables[1] : nullptr)} {
+	tickDuties[0] = solenoids[0].toDuty(tickState.cv);
+	tickDuties[1] = solenoids[1].toDuty(getCvMin() + 1 - tickState.cv);
+}
+
+void SingleHumidistat::tick() {
+	if (cycleDue(cs.dt)) {
+		// Count a deferred cycle for runPendingCycle(), or run it right away
+		if (config::deferCycles) {
+			if (pendingCycles < UINT8_MAX)
+				pendingCycles++;
+		} else {
+			runEstimator(cs.dt);
+			runCycle();
+		}
+	}
+
+	// Actuate solenoids (with deferred cycles, the conversion to duty cycles is done in the main loop as well)
+	if (config::deferCycles) {
+		solenoids[0].writeDuty(tickDuties[0]);
+		solenoids[1].writeDuty(tickDuties[1]);
+	} else {
+		double cv = tickState.cv;
+		solenoids[0].write(cv);
+		solenoids[1].write(getCvMin() + 1 - cv);
+	}
+}
+
+void SingleHumidistat::runPendingCycle() {
+	noInterrupts();
+	uint8_t n = pendingCycles;
+	pendingCycles = 0;
+	interrupts();
+	if (n == 0)
+		return;
+
+	// The tick only reads the duty cycles, so the cycles themselves can run with interrupts enabled. Catch up on the
+	// cycles missed while the main loop was busy, each over a full timestep, so that the PID (whose coefficients
+	// assume a constant dt), the setpoint ramp and the estimator keep time with the tick; only the outputs are late.
+	for (uint8_t i = 0; i < n; i++) {
+		runEstimator(cs.dt);
+		runCycle();
+	}
+	publishOutputs();
+}
+
+void SingleHumidistat::ditherSolenoids() {
+	solenoids[0].dither();
+	solenoids[1].dither();
+}
+
+void SingleHumidistat::publishOutputs() {
+	if (!config::deferCycles)
+		return;
+
+	uint32_t duties[2] = {solenoids[0].toDuty(tickState.cv), solenoids[1].toDuty(getCvMin() + 1 - tickState.cv)};
+	noInterrupts();
+	tickDuties[0] = duties[0];
+	tickDuties[1] = duties[1];
+	interrupts();
+}
 
 void SingleHumidistat::update() {
-	runCycle();
+	sample();
+
+	// Apply the tuned gains when the autotuner has finished
+	if (finishAutotune() == RelayAutotuner::State::done)
+		updatePIDParameters();
 
-	// Actuate solenoids (convert normalised double CV to integer PWM value)
-	analogWrite(pins_solenoid[0], static_cast<int>(cv * ipow(2, pwmRes)));
-	analogWrite(pins_solenoid[1], static_cast<int>((pid.cvMin + 1 - cv) * ipow(2, pwmRes)));
+	noInterrupts();
+	exchangeState();
+	interrupts();
+	publishOutputs();
 }
 
 void SingleHumidistat::updatePIDParameters() {
+	noInterrupts();
 	pid.setGains(cs.HC_Kp, cs.HC_Ki, cs.HC_Kd, cs.HC_Kf, cs.dt);
-	pid.cvMin = cs.S_lowValue;
+	pid.setWeights(cs.HC_b / 100., cs.HC_c / 100.);
+	pid.setDerivativeFilter(cs.HC_Tf, config::D_filterOrder);
+	updateModel();
+	updateRamp();
+	pid.setCvLimits(solenoidCvMin(cs), getCvMax());
+	interrupts();
+	publishOutputs();
+	checkModel();
 }
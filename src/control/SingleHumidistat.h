@@ -7,13 +7,21 @@
 #include "aliases.h"
 #include "Humidistat.h"
 #include "EEPROMConfig.h"
+#include "../actuator/Solenoid.h"
 
 /// Control humidity using PID by driving two solenoid valves.
 /// Adjust the public setpoint variable and call update().
 class SingleHumidistat : public Humidistat {
 private:
-	const uint8_t pins_solenoid[2];
-	const uint8_t pwmRes;
+	Solenoid solenoids[2];
+
+	uint32_t tickDuties[2] = {0, 0};    //!< Duty cycles of the solenoids, for the control tick (see deferCycles)
+	volatile uint8_t pendingCycles = 0; //!< Number of deferred cycles that are due (see deferCycles)
+
+	/// Convert the cv to the duty cycles of the solenoids, and hand these over to the control tick. Call this from the
+	/// main loop, after every deferred cycle and every exchange of the state (if the cycles are not deferred, the
+	/// tick converts the cv itself).
+	void publishOutputs();
 
 public:
 	/// Constructor.
@@ -21,11 +29,24 @@ public:
 	/// \param cs            Pointer to a ConfigStore instance
 	/// \param pins_solenoid Array of 2 integers corresponding to the solenoid pins
 	/// \param pwmRes        PWM resolution (bits)
-	SingleHumidistat(HumiditySensor *hs, const ConfigStore *cs, etl::array<uint8_t, 2> pins_solenoid, uint8_t pwmRes);
+	/// \param channel       Index of the control channel
+	SingleHumidistat(HumiditySensor *hs, ConfigStore *cs, etl::array<uint8_t, 2> pins_solenoid, uint8_t pwmRes,
+	                 uint8_t channel);
 
 	// Overridden from Controller
+	void tick();
 	void update();
 	void updatePIDParameters();
+
+	/// Write the dithered duty cycles of the solenoids for the next PWM period. Call this from the overflow interrupt
+	/// of the timer driving the PWM, if PWM_period = 0 (see Solenoid::dither()).
+	void ditherSolenoids();
+
+	/// Run the cycles of the PID loop counted by the control tick, if any. If the main loop has fallen behind by more
+	/// than a timestep, the missed cycles are run back to back, so that the PID, the setpoint ramp and the estimator
+	/// still advance by dt per tick. Call this from the main loop, as often as possible (if the cycles are not
+	/// deferred, this does nothing).
+	void runPendingCycle();
 };
 
 #endif //HUMIDISTAT_SINGLEHUMIDISTAT_H
@@ -0,0 +1,44 @@
+#include <math.h>
+
+#include "SmithPredictor.h"
+
+void SmithPredictor::setModel(double K, double tau, double L, uint16_t dt, double cv) {
+	this->K = K;
+	alpha = tau > 0 ? exp(-static_cast<double>(dt) / 1000 / tau) : 0;
+
+	double steps = round(L * 1000 / dt);
+	if (steps < 0)
+		steps = 0;
+	clamped = steps > length - 1;
+	if (clamped)
+		steps = length - 1;
+	delay = static_cast<uint8_t>(steps);
+
+	reset(cv);
+}
+
+void SmithPredictor::reset(double cv) {
+	ym = K * cv;
+	for (double &y : buffer)
+		y = ym;
+}
+
+double SmithPredictor::correct(double pv) const {
+	uint8_t tail = (head + length - delay) % length;
+	return pv + ym - buffer[tail];
+}
+
+void SmithPredictor::update(double cv) {
+	ym = alpha * ym + (1 - alpha) * K * cv;
+
+	head = (head + 1) % length;
+	buffer[head] = ym;
+}
+
+bool SmithPredictor::isClamped() const {
+	return clamped;
+}
+
+uint8_t SmithPredictor::getDelay() const {
+	return delay;
+}
@@ -0,0 +1,58 @@
+#ifndef HUMIDISTAT_SMITHPREDICTOR_H
+#define HUMIDISTAT_SMITHPREDICTOR_H
+
+#include <stdint.h>
+
+#include CONFIG_HEADER
+
+/// Smith predictor for dead-time compensation.
+/// Runs a first-order-plus-dead-time (FOPDT) model of the process alongside the PID controller. The process variable
+/// fed back to the controller is corrected by the difference between the model output without and with dead time,
+/// so that the controller effectively sees the process without dead time (provided that the model is accurate).
+class SmithPredictor {
+private:
+	static constexpr uint8_t length = config::SP_length; //!< Length of the delay line
+
+	double K;      //!< Process gain
+	double alpha;  //!< Discrete-time model pole: exp(-dt/tau)
+	uint8_t delay; //!< Dead time (in timesteps)
+	bool clamped;  //!< Whether the dead time was clamped to the length of the delay line
+
+	double ym;             //!< Model output without dead time
+	double buffer[length]; //!< Delay line of past model outputs
+	uint8_t head = 0;      //!< Index of the newest entry in the delay line
+
+public:
+	/// Set the model parameters, and reset the model to steady state.
+	/// The dead time is limited to (length - 1) timesteps.
+	/// \param K   Process gain (change in process variable per unit change in control variable)
+	/// \param tau Time constant (in s)
+	/// \param L   Dead time (in s)
+	/// \param dt  Timestep (in ms)
+	/// \param cv  Control variable
+	void setModel(double K, double tau, double L, uint16_t dt, double cv);
+
+	/// Reset the model to steady state at the given control variable.
+	/// \param cv Control variable
+	void reset(double cv);
+
+	/// Correct the process variable for the dead time.
+	/// \param pv Process variable
+	/// \return Corrected process variable
+	[[nodiscard]] double correct(double pv) const;
+
+	/// Advance the model by one timestep. Call this every timestep, after the controller has computed its output.
+	/// \param cv Control variable
+	void update(double cv);
+
+	/// Whether the dead time of the model was clamped (to length - 1 timesteps), as of the last setModel().
+	/// \return True if clamped
+	[[nodiscard]] bool isClamped() const;
+
+	/// Get the dead time of the model, after clamping.
+	/// \return Dead time (in timesteps)
+	[[nodiscard]] uint8_t getDelay() const;
+};
+
+
+#endif //HUMIDISTAT_SMITHPREDICTOR_H
@@ -0,0 +1,47 @@
+#include "ValveCalibrator.h"
+
+void ValveCalibrator::start(uint16_t dt) {
+	stepLength = config::VC_stepTime / dt;
+	if (stepLength < 2)
+		stepLength = 2;
+
+	currentStep = 0;
+	count = 0;
+	sum = 0;
+	state = State::running;
+}
+
+double ValveCalibrator::step(double flowrate) {
+	if (state != State::running)
+		return 0;
+
+	// Average over the second half of the step
+	if (count >= stepLength / 2)
+		sum += flowrate;
+
+	if (++count >= stepLength) {
+		flows[currentStep] = sum / (stepLength - stepLength / 2);
+		count = 0;
+		sum = 0;
+
+		if (++currentStep >= nSteps) {
+			// Without any flow, the table would be meaningless
+			state = flows[nSteps - 1] > 0 ? State::done : State::failed;
+			return 0;
+		}
+	}
+
+	return static_cast<double>(currentStep) / (nSteps - 1);
+}
+
+ValveCalibrator::State ValveCalibrator::getState() const {
+	return state;
+}
+
+bool ValveCalibrator::isRunning() const {
+	return state == State::running;
+}
+
+void ValveCalibrator::reset() {
+	state = State::idle;
+}
@@ -0,0 +1,89 @@
+#ifndef HUMIDISTAT_VALVECALIBRATOR_H
+#define HUMIDISTAT_VALVECALIBRATOR_H
+
+#include <stdint.h>
+
+#include CONFIG_HEADER
+#include "../ValveTable.h"
+
+/// Calibrates a solenoid valve by sweeping its duty cycle from 0 to 1 in VC_steps steps, and recording the flowrate
+/// (averaged over the second half of each step, to let it settle). From this, a monotone inverse lookup table
+/// (ValveTable) is built.
+class ValveCalibrator {
+public:
+	enum class State : uint8_t {
+		idle,
+		running,
+		done,
+		failed,
+	};
+
+private:
+	static constexpr uint8_t nSteps = config::VC_steps;
+
+	volatile State state = State::idle;
+
+	uint16_t stepLength;  //!< Length of each step of the sweep (in timesteps)
+	uint8_t currentStep;  //!< Current step of the sweep
+	uint16_t count;       //!< Number of timesteps in the current step
+	double sum;           //!< Sum of the flowrates over the second half of the current step
+	double flows[nSteps]; //!< Average flowrate at each step
+
+public:
+	/// Start the sweep.
+	/// \param dt Timestep (in ms)
+	void start(uint16_t dt);
+
+	/// Run a timestep of the sweep. Call this every timestep instead of computing the PID.
+	/// \param flowrate Flowrate
+	/// \return Duty cycle (not linearised)
+	double step(double flowrate);
+
+	/// Get the state of the calibration.
+	/// \return State
+	[[nodiscard]] State getState() const;
+
+	/// Whether the sweep is running.
+	/// \return True if running
+	[[nodiscard]] bool isRunning() const;
+
+	/// Reset the state to idle (after a finished calibration has been processed).
+	void reset();
+
+	/// Build the inverse lookup table from the sweep. Only valid if the state is done.
+	/// \param table Table to write into
+	template<uint8_t N>
+	void getTable(ValveTable<N> &table) const {
+		// The flowrate should increase with the duty cycle: take the running maximum to make it monotone
+		double monotone[nSteps];
+		double max = 0;
+		for (uint8_t j = 0; j < nSteps; ++j) {
+			if (flows[j] > max)
+				max = flows[j];
+			monotone[j] = max;
+		}
+
+		// Zero flowrate maps to the end of the deadband (the last step without appreciable flow)
+		uint8_t j = 0;
+		while (j < nSteps - 1 && monotone[j + 1] <= config::VC_threshold * max)
+			++j;
+		table.duty[0] = static_cast<uint16_t>(65535. * j / (nSteps - 1));
+
+		for (uint8_t i = 1; i < N; ++i) {
+			// Find the step at which the target flowrate is reached, and interpolate
+			double target = max * i / (N - 1);
+			while (j < nSteps - 1 && monotone[j] < target)
+				++j;
+
+			double duty = static_cast<double>(j) / (nSteps - 1);
+			if (j > 0 && monotone[j] > monotone[j - 1])
+				duty -= (monotone[j] - target) / (monotone[j] - monotone[j - 1]) / (nSteps - 1);
+			table.duty[i] = static_cast<uint16_t>(duty * 65535 + 0.5);
+			if (table.duty[i] < table.duty[i - 1])
+				table.duty[i] = table.duty[i - 1];
+		}
+	}
+};
+
+
+#endif //HUMIDISTAT_VALVECALIBRATOR_H
@@ -22,4 +22,32 @@ constexpr unsigned int ilog10(int n) {
 	}
 }
 
+/// Constexpr natural logarithm (for generating tables at compile time). The argument is scaled into [1, 2) by
+/// powers of two, and the logarithm of the mantissa is calculated from the series of atanh.
+/// \param x Argument (positive)
+/// \return ln(x)
+constexpr double ln(double x) {
+	constexpr double ln2 = 0.69314718055994531;
+
+	int k = 0;
+	while (x >= 2) {
+		x /= 2;
+		k++;
+	}
+	while (x < 1) {
+		x *= 2;
+		k--;
+	}
+
+	// ln(x) = 2 atanh(y), with y = (x - 1)/(x + 1) in [0, 1/3)
+	double y = (x - 1) / (x + 1);
+	double term = y;
+	double sum = 0;
+	for (unsigned int n = 1; n < 40; n += 2) {
+		sum += term / n;
+		term *= y * y;
+	}
+	return k * ln2 + 2 * sum;
+}
+
 #endif //HUMIDISTAT_IMATH_H
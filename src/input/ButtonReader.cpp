@@ -1,10 +1,11 @@
 #include <Arduino.h>
 #include "ButtonReader.h"
 
-ButtonReader::ButtonReader(uint8_t pin_btn, const VoltLadder *voltLadder) : voltLadder(*voltLadder), pin_btn(pin_btn) {}
+ButtonReader::ButtonReader(ADCScanner *adc, uint8_t pin_btn, const VoltLadder *voltLadder)
+		: voltLadder(*voltLadder), adc(*adc), channel(adc->add(pin_btn)) {}
 
 void ButtonReader::sample() {
-	Buttons state = voltLadder.voltageToButton(analogRead(pin_btn));
+	Buttons state = voltLadder.voltageToButton(adc.read(channel) >> ADCScanner::extraBits);
 	if (state != lastState) {
 		lastState = state;
 		pressedSince = micros();
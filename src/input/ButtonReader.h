@@ -5,20 +5,23 @@
 
 #include "aliases.h"
 #include "Buttons.h"
+#include "sensor/ADCScanner.h"
 
 /// Read button state from a voltage ladder-style keypad.
 class ButtonReader {
 private:
 	const VoltLadder &voltLadder; //!< Reference to a voltLadder instance
-	uint8_t pin_btn;              //!< Pin corresponding to the keypad
+	const ADCScanner &adc;        //!< Reference to the ADCScanner instance
+	const uint8_t channel;        //!< ADC channel of the keypad pin
 
 	Buttons lastState = Buttons::NONE; //!< Last sampled state of the keypad
 	unsigned long pressedSince = 0;    //!< Time of the start of the keypress (in micros)
 public:
 	/// Constructor.
+	/// \param adc        Pointer to the ADCScanner instance
 	/// \param pin_btn    Pin corresponding to the keypad
 	/// \param voltLadder Pointer to VoltLadder instance
-	explicit ButtonReader(uint8_t pin_btn, const VoltLadder *voltLadder);
+	ButtonReader(ADCScanner *adc, uint8_t pin_btn, const VoltLadder *voltLadder);
 
 	/// Sample the button signal. Call this in the main loop.
 	void sample();
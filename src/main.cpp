@@ -4,34 +4,57 @@
 #include "aliases.h"
 
 #include "EEPROMConfig.h"
+#include "makeArray.h"
 #include "SerialLogger.h"
 #include "input/ButtonReader.h"
-#include "sensor/ThermistorReader.h"
+#include "sensor/ADCScanner.h"
+#include "sensor/ThermistorBank.h"
 #include "SetpointProfileRunner.h"
+#include "ControlTimer.h"
+#include "TaskScheduler.h"
+#include "TimingStats.h"
 
 // Beware: Lots of preprocessor fuckery to get conditional compilation based on config settings below
 
-// Humidity sensor
-#ifdef HUMIDISTAT_DHT
-DHT dht(config::PIN_DHT, DHT22);
-DHTHumiditySensor hs(&dht);
-#endif
-#ifdef HUMIDISTAT_SHT
-SHTSensor sht;
-SHTHumiditySensor hs(&sht);
+// Background scan of the analog inputs (the sensors below register their pins)
+ADCScanner adcScanner;
+
+// Humidity sensors (one for each channel, possibly fusing two sensors each)
+#if defined(HUMIDISTAT_DHT) && defined(HUMIDISTAT_SHT)
+SHTHumiditySensor sht;
+DHTHumiditySensor dht(config::PIN_DHT);
+HumiditySensor hss[] = {HumiditySensor(&sht, &dht)};
+#elif defined(HUMIDISTAT_DHT)
+DHTHumiditySensor hss[] = {DHTHumiditySensor(config::PIN_DHT)};
+#elif defined(HUMIDISTAT_SHT_PAIR)
+#include "sensor/I2CMux.h"
+I2CMux i2cMux(config::I2CMuxAddress);
+auto shts = makeArray<SHTHumiditySensor, 2 * config::nChannels>([](size_t i) {
+	return SHTHumiditySensor(&i2cMux, i);
+});
+auto hss = makeArray<HumiditySensor, config::nChannels>([](size_t i) {
+	return HumiditySensor(&shts[2 * i], &shts[2 * i + 1]);
+});
+#elif defined(HUMIDISTAT_SHT)
+#include "sensor/I2CMux.h"
+I2CMux i2cMux(config::I2CMuxAddress);
+auto hss = makeArray<SHTHumiditySensor, config::nChannels>([](size_t i) {
+	return SHTHumiditySensor(config::nChannels > 1 ? &i2cMux : nullptr, i);
+});
 #endif
 
 // Thermistors
 ThermistorReader trs[] = {
-		ThermistorReader(config::PIN_T1),
-		ThermistorReader(config::PIN_T2),
-		ThermistorReader(config::PIN_T3),
-		ThermistorReader(config::PIN_T4)
+		ThermistorReader(&adcScanner, config::PIN_T1),
+		ThermistorReader(&adcScanner, config::PIN_T2),
+		ThermistorReader(&adcScanner, config::PIN_T3),
+		ThermistorReader(&adcScanner, config::PIN_T4)
 };
+ThermistorBank thermistors(trs);
 
 // Input
 VoltLadder voltLadder;
-ButtonReader buttonReader(config::PIN_BTN, &voltLadder);
+ButtonReader buttonReader(&adcScanner, config::PIN_BTN, &voltLadder);
 
 EEPROMConfig eepromConfig;
 
@@ -44,27 +67,39 @@ const uint8_t pwmRes = 15;
 const uint8_t pwmRes = 8;
 #endif
 
-// Humidity controller
+// Humidity controllers (one for each channel)
 #ifdef HUMIDISTAT_CONTROLLER_SINGLE
 #include "control/SingleHumidistat.h"
-SingleHumidistat humidistat(&hs, &eepromConfig.configStore, {{config::PIN_S1, config::PIN_S2}}, pwmRes);
+auto humidistats = makeArray<SingleHumidistat, config::nChannels>([](size_t i) {
+	return SingleHumidistat(&hss[i], &eepromConfig.configStores[i], {{config::PIN_S[i][0], config::PIN_S[i][1]}},
+	                        pwmRes, i);
+});
 using cHumidistat = SingleHumidistat;
 #endif
 #ifdef HUMIDISTAT_CONTROLLER_CASCADE
 #include "sensor/FlowSensor.h"
 #include "control/CascadeHumidistat.h"
-FlowSensor flowSensors[] = {FlowSensor(config::PIN_F1), FlowSensor(config::PIN_F2)};
-CascadeHumidistat humidistat(&hs, &eepromConfig.configStore, flowSensors, {config::PIN_S1, config::PIN_S2}, pwmRes);
+auto flowSensors = makeArray<etl::array<FlowSensor, 2>, config::nChannels>([](size_t i) {
+	return etl::array<FlowSensor, 2>{{FlowSensor(&adcScanner, config::PIN_F[i][0]),
+	                                  FlowSensor(&adcScanner, config::PIN_F[i][1])}};
+});
+auto humidistats = makeArray<CascadeHumidistat, config::nChannels>([](size_t i) {
+	return CascadeHumidistat(&hss[i], &eepromConfig.configStores[i], flowSensors[i],
+	                         {config::PIN_S[i][0], config::PIN_S[i][1]}, pwmRes, i);
+});
 using cHumidistat = CascadeHumidistat;
 #endif
 
+// The UI and the setpoint profiles operate on the first channel
+cHumidistat &humidistat = humidistats[0];
+
 // UI
 #ifdef HUMIDISTAT_UI_CHAR
 #include <LiquidCrystal.h>
 #include "ui/CharDisplayUI.h"
 LiquidCrystal liquidCrystal(config::PIN_LCD_RS, config::PIN_LCD_ENABLE, config::PIN_LCD_D0, config::PIN_LCD_D1,
 							config::PIN_LCD_D2, config::PIN_LCD_D3);
-CharDisplayUI ui(&liquidCrystal, &buttonReader, &humidistat, trs);
+CharDisplayUI ui(&liquidCrystal, &buttonReader, &humidistat, &thermistors);
 #endif
 #ifdef HUMIDISTAT_UI_GRAPH
 #include <U8g2lib.h>
@@ -78,35 +113,97 @@ U8G2_ST7920_128X64_F_HW_SPI u8g2(U8G2_R0, config::PIN_LCD_CS);
 #ifdef ARDUINO_TEENSY40
 U8G2_ST7920_128X64_F_SW_SPI u8g2(U8G2_R0, config::PIN_LCD_SCLK, config::PIN_LCD_MOSI, config::PIN_LCD_CS);
 #endif
-GraphicalDisplayUI<cHumidistat> ui(&u8g2, &buttonReader, &humidistat, trs, &eepromConfig, &spr);
+GraphicalDisplayUI<cHumidistat> ui(&u8g2, &buttonReader, &humidistat, &thermistors, &eepromConfig, &spr);
+#endif
+
+SerialLogger<cHumidistat> serialLogger(humidistats, &thermistors, eepromConfig.configStore.dt);
+
+TimingStats tickStats;
+
+/// Control tick, called from the timer interrupt.
+void tick() {
+	uint32_t start = TimingStats::now();
+#if defined(ARDUINO_TEENSYLC) || defined(ARDUINO_TEENSY40)
+	adcScanner.step();
+#endif
+	for (cHumidistat &h : humidistats)
+		h.tick();
+	tickStats.record(TimingStats::now() - start);
+}
+
+#ifdef ARDUINO_AVR_UNO
+/// Timer2 overflow interrupt: Timer2 drives the PWM of the solenoid pins (in phase-correct mode, which updates the
+/// duty cycle at the top), so this fires once per PWM period. Used for dithering (see PWM_period).
+ISR(TIMER2_OVF_vect) {
+	for (cHumidistat &h : humidistats)
+		h.ditherSolenoids();
+}
+#endif
+
+/// Update the humidistats of all channels.
+void updateHumidistats() {
+	for (cHumidistat &h : humidistats)
+		h.update();
+}
+
+// Task table for the main loop: name, function, period (ms), priority, budget (us)
+Task tasks[] = {
+#ifdef HUMIDISTAT_CONTROLLER_SINGLE
+	{"cycles",      [] { for (cHumidistat &h : humidistats) h.runPendingCycle(); },
+	                                                                 1, 0,  5000},
 #endif
+	{"humidistat",  updateHumidistats,                              10, 1, 20000 * config::nChannels},
+	{"buttons",     [] { buttonReader.sample(); },                   1, 2,   200},
+	{"logger",      [] { serialLogger.update(); },                  10, 3,  5000},
+#ifdef HUMIDISTAT_UI_GRAPH
+	{"profile",     [] { spr.update(); },                          100, 4,   200},
+#endif
+	{"ui",          [] { ui.update(); },                            10, 5, 50000},
+	{"thermistors", [] { thermistors.update(); }, config::NTC_interval, 6,  2000},
+};
+TaskScheduler scheduler(tasks);
 
-SerialLogger<cHumidistat> serialLogger(&humidistat, trs, eepromConfig.configStore.dt);
+/// Print the timing statistics of the control tick and the tasks.
+void printStats() {
+	// Take a consistent copy of the statistics of the control tick
+	noInterrupts();
+	TimingStats stats = tickStats;
+	interrupts();
+
+	stats.print(Serial, "tick");
+	scheduler.printStats(Serial);
+}
 
 void setup() {
 #ifdef ARDUINO_AVR_UNO
 	// Set PWM frequency on D3 and D11 to 490.20 Hz
 	// See: https://arduinoinfo.mywikis.net/wiki/Arduino-PWM-Frequency
 	TCCR2B = TCCR2B & B11111000 | B00000100;
+
+	// Dither the solenoids once per PWM period, from the Timer2 overflow interrupt
+	if (config::PWM_dither && config::PWM_period == 0)
+		TIMSK2 |= (1 << TOIE2);
 #endif
 #if defined(ARDUINO_TEENSYLC) || defined(ARDUINO_TEENSY40)
 	// Set PWM frequency to 250 Hz
-	analogWriteFrequency(config::PIN_S1, 500);
+	for (uint8_t i = 0; i < config::nChannels; i++) {
+		analogWriteFrequency(config::PIN_S[i][0], 500);
+		analogWriteFrequency(config::PIN_S[i][1], 500);
+	}
 	// Increase PWM resolution from default 8-bits
 	analogWriteResolution(pwmRes);
 #endif
 
-	hs.begin();
+	for (auto &hs : hss)
+		hs.begin();
 	serialLogger.begin(config::serialRate);
+	serialLogger.setStatsPrinter(printStats);
 	ui.begin();
+
+	adcScanner.begin();
+	ControlTimer::begin(tick);
 }
 
 void loop() {
-	buttonReader.sample();
-	ui.update();
-	humidistat.update();
-	serialLogger.update();
-#ifdef HUMIDISTAT_UI_GRAPH
-	spr.update();
-#endif
+	scheduler.run();
 }
@@ -0,0 +1,25 @@
+#ifndef HUMIDISTAT_MAKEARRAY_H
+#define HUMIDISTAT_MAKEARRAY_H
+
+#include <stddef.h>
+#include <etl/array.h>
+#include <etl/utility.h>
+
+template<typename T, size_t N, typename F, size_t... I>
+etl::array<T, N> makeArray(F f, etl::index_sequence<I...>) {
+	return {{f(I)...}};
+}
+
+/// Make an array of N objects, constructing each element by calling a function with its index.
+/// The elements are constructed in place (guaranteed copy elision), so they can safely hold pointers into themselves
+/// (like Controller does) and need not be copyable.
+/// \tparam T Element type
+/// \tparam N Number of elements
+/// \param f Function (typically a lambda) taking the index and returning a T
+/// \return Array
+template<typename T, size_t N, typename F>
+etl::array<T, N> makeArray(F f) {
+	return makeArray<T, N>(f, etl::make_index_sequence<N>{});
+}
+
+#endif //HUMIDISTAT_MAKEARRAY_H
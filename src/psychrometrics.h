@@ -0,0 +1,33 @@
+#ifndef HUMIDISTAT_PSYCHROMETRICS_H
+#define HUMIDISTAT_PSYCHROMETRICS_H
+
+#include <math.h>
+
+/// Saturation vapour pressure over water, using the Magnus formula (WMO parameters).
+/// \param T Temperature (Celsius)
+/// \return Saturation vapour pressure (hPa)
+inline double saturationVapourPressure(double T) {
+	return 6.112 * exp(17.62 * T / (243.12 + T));
+}
+
+/// Steady-state fraction of the wet stream in a mixture of a wet and a dry stream, for a target relative humidity.
+/// The vapour pressure of the mixture is the flow-weighted average of the vapour pressures of the streams.
+/// \param rh    Target relative humidity (percent), at temperature T
+/// \param T     Temperature of the mixture (Celsius)
+/// \param wetRH Relative humidity of the wet stream (percent), at temperature lineT
+/// \param dryRH Relative humidity of the dry stream (percent), at temperature lineT
+/// \param lineT Temperature of the streams (Celsius)
+/// \return Wet fraction, clipped to [0, 1]
+inline double mixingWetFraction(double rh, double T, double wetRH, double dryRH, double lineT) {
+	double es = saturationVapourPressure(T);
+	double esLine = saturationVapourPressure(lineT);
+
+	double fraction = (rh * es - dryRH * esLine) / ((wetRH - dryRH) * esLine);
+	if (!(fraction > 0))
+		return 0;
+	if (fraction > 1)
+		return 1;
+	return fraction;
+}
+
+#endif //HUMIDISTAT_PSYCHROMETRICS_H
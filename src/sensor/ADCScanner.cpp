@@ -0,0 +1,88 @@
+#include <Arduino.h>
+
+#include "ADCScanner.h"
+
+uint8_t ADCScanner::add(uint8_t pin) {
+	for (uint8_t i = 0; i < nChannels; i++)
+		if (pins[i] == pin)
+			return i;
+
+	if (nChannels == maxChannels) {
+		overflow = true;
+		return 0;
+	}
+	pins[nChannels] = pin;
+	return nChannels++;
+}
+
+void ADCScanner::begin() {
+	if (overflow)
+		Serial.println("# Too many analog inputs: raise ADC_nChannels");
+
+	for (uint8_t i = 0; i < nChannels; i++) {
+		values[i] = analogRead(pins[i]) << extraBits;
+		sums[i] = 0;
+	}
+	current = 0;
+	rounds = 0;
+	start();
+}
+
+uint16_t ADCScanner::read(uint8_t channel) const {
+	uint8_t before;
+	uint16_t value;
+	do {
+		before = seq;
+		value = values[channel];
+	} while ((before & 1) || before != seq);
+	return value;
+}
+
+void ADCScanner::complete(uint16_t value) {
+	sums[current] += value;
+	if (++current == nChannels) {
+		current = 0;
+		if (++rounds == samples) {
+			rounds = 0;
+
+			// Decimate and publish
+			seq++;
+			for (uint8_t i = 0; i < nChannels; i++) {
+				values[i] = sums[i] >> extraBits;
+				sums[i] = 0;
+			}
+			seq++;
+		}
+	}
+	start();
+}
+
+#ifdef ARDUINO_AVR_UNO
+static ADCScanner *scanner = nullptr; //!< Instance served by the conversion-complete interrupt
+
+ISR(ADC_vect) {
+	scanner->complete(ADC);
+}
+
+void ADCScanner::start() {
+	if (nChannels == 0)
+		return;
+	scanner = this;
+
+	// AVcc reference, prescaler of 128 (125 kHz ADC clock, about 104 us per conversion), interrupt on completion
+	uint8_t pin = pins[current];
+	ADMUX = (1 << REFS0) | ((pin >= A0 ? pin - A0 : pin) & 0x07);
+	ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADIE) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+}
+
+void ADCScanner::step() {}
+#endif
+
+#if defined(ARDUINO_TEENSYLC) || defined(ARDUINO_TEENSY40)
+void ADCScanner::start() {}
+
+void ADCScanner::step() {
+	if (nChannels > 0)
+		complete(analogRead(pins[current]));
+}
+#endif
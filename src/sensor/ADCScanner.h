@@ -0,0 +1,62 @@
+#ifndef HUMIDISTAT_ADCSCANNER_H
+#define HUMIDISTAT_ADCSCANNER_H
+
+#include <stdint.h>
+
+#include CONFIG_HEADER
+
+/// Background scan of the analog inputs.
+/// The registered pins are sampled round-robin in the background: on AVR, driven by the ADC conversion-complete
+/// interrupt; on Teensy, one conversion per control tick (see step()). Every channel is oversampled 4^extraBits times
+/// and decimated, for extraBits more bits of resolution. The decimated values are published under a sequence lock, so
+/// that consumers can read the latest value of a channel in constant time, without disabling interrupts.
+class ADCScanner {
+public:
+	static constexpr uint8_t extraBits = config::ADC_extraBits; //!< Bits of resolution gained by oversampling
+	static constexpr uint8_t samples = 1 << (2 * extraBits);     //!< Samples per channel per published value
+
+private:
+	static constexpr uint8_t maxChannels = config::ADC_nChannels;
+
+	uint8_t pins[maxChannels]{}; //!< Pin of each channel
+	uint8_t nChannels = 0;       //!< Number of registered channels
+	bool overflow = false;       //!< Whether a pin could not be registered, as all channels were taken
+
+	uint16_t sums[maxChannels]{}; //!< Sum of the samples of each channel since the last publish
+	uint8_t current = 0;          //!< Channel being converted
+	uint8_t rounds = 0;           //!< Number of rounds over all channels since the last publish
+
+	volatile uint16_t values[maxChannels]{}; //!< Published values (with extraBits fractional bits)
+	volatile uint8_t seq = 0;                //!< Sequence counter: odd while the values are being published
+
+	/// Start a conversion of the current channel (AVR only).
+	void start();
+
+public:
+	/// Register an analog pin (if not registered yet). Call this before begin(). If all ADC_nChannels channels are
+	/// taken, the pin is not scanned, and begin() reports the error on the serial port.
+	/// \param pin Analog pin number
+	/// \return Channel index, to be passed to read() (0 if the pin could not be registered)
+	uint8_t add(uint8_t pin);
+
+	/// Seed the values with a synchronous conversion of every channel, and start the background scan. Call this after
+	/// Serial.begin().
+	void begin();
+
+	/// Run a single conversion (Teensy only). Call this from the control tick.
+	void step();
+
+	/// Handle a completed conversion of the current channel: add the sample, advance to the next channel (starting its
+	/// conversion on AVR), and publish the values after every `samples` rounds. Called from the conversion-complete
+	/// interrupt (AVR) or step() (Teensy).
+	/// \param value ADC value
+	void complete(uint16_t value);
+
+	/// Get the latest value of a channel.
+	/// \param channel Channel index (see add())
+	/// \return ADC value, with extraBits fractional bits
+	[[nodiscard]] uint16_t read(uint8_t channel) const;
+};
+
+
+#endif //HUMIDISTAT_ADCSCANNER_H
@@ -1,19 +1,104 @@
+#include <Arduino.h>
+
 #include "DHTHumiditySensor.h"
 
-DHTHumiditySensor::DHTHumiditySensor(DHT *dht) : dht(*dht) {}
+DHTHumiditySensor *DHTHumiditySensor::instance = nullptr;
+
+DHTHumiditySensor::DHTHumiditySensor(uint8_t pin) : pin(pin), frame{}, nEdges(0), lastRise(0) {}
 
 double DHTHumiditySensor::getHumidity() const {
-	return dht.readHumidity();
+	return h;
 }
 
 double DHTHumiditySensor::getTemperature() const {
-	return dht.readTemperature();
+	return t;
 }
 
 void DHTHumiditySensor::begin() {
-	dht.begin();
+	instance = this;
+	pinMode(pin, INPUT_PULLUP);
+}
+
+bool DHTHumiditySensor::readSample() {
+	// nEdges is a single byte, so it can be read without disabling interrupts
+	if (!requested || (nEdges < nFrameEdges && millis() - requestTime < frameTimeout))
+		return false;
+	decode();
+	return true;
+}
+
+bool DHTHumiditySensor::isFresh() const {
+	return fresh;
+}
+
+uint16_t DHTHumiditySensor::getChecksumFailures() const {
+	return checksumFailures;
+}
+
+void DHTHumiditySensor::onEdge() {
+	DHTHumiditySensor &s = *instance;
+	unsigned long now = micros();
+
+	if (digitalRead(s.pin) == HIGH) {
+		s.lastRise = now;
+		return;
+	}
+
+	// The first two falling edges end the release of the start signal and the response of the sensor; every next one
+	// ends the high pulse of a data bit, whose duration encodes its value
+	uint8_t bit = s.nEdges - 2;
+	if (s.nEdges < nFrameEdges)
+		s.nEdges++;
+	if (bit < 40 && now - s.lastRise > bitThreshold)
+		s.frame[bit / 8] |= 0x80 >> (bit % 8);
+}
+
+void DHTHumiditySensor::requestSample() {
+	uint8_t interrupt = digitalPinToInterrupt(pin);
+	detachInterrupt(interrupt);
+
+	for (volatile uint8_t &byte : frame)
+		byte = 0;
+	nEdges = 0;
+
+	// Start signal: pull the line low, then release it (interrupts stay enabled)
+	pinMode(pin, OUTPUT);
+	digitalWrite(pin, LOW);
+	delayMicroseconds(startTime);
+#ifdef ARDUINO_AVR_UNO
+	// The edge detector stays armed after detachInterrupt(), so pulling the line low has set the interrupt flag, and
+	// attachInterrupt() does not clear it: clear it here, or the handler would count a spurious falling edge
+	EIFR = bit(INTF0 + interrupt);
+#endif
+	attachInterrupt(interrupt, onEdge, CHANGE);
+	pinMode(pin, INPUT_PULLUP);
+
+	requested = true;
+	requestTime = millis();
 }
 
-void DHTHumiditySensor::readSample() {
-	dht.read(true);
+void DHTHumiditySensor::decode() {
+	requested = false;
+	fresh = false;
+	h = t = NAN;
+
+	noInterrupts();
+	uint8_t n = nEdges;
+	uint8_t data[5];
+	for (uint8_t i = 0; i < 5; i++)
+		data[i] = frame[i];
+	interrupts();
+
+	if (n < nFrameEdges)
+		return;
+	if (static_cast<uint8_t>(data[0] + data[1] + data[2] + data[3]) != data[4]) {
+		checksumFailures++;
+		return;
+	}
+
+	h = (data[0] << 8 | data[1]) / 10.;
+	t = ((data[2] & 0x7F) << 8 | data[3]) / 10.;
+	if (data[2] & 0x80)
+		t = -t;
+	fresh = true;
 }
@@ -1,18 +1,75 @@
 #ifndef HUMIDISTAT_DHTHUMIDITYSENSOR_H
 #define HUMIDISTAT_DHTHUMIDITYSENSOR_H
 
-#include "DHT.h"
+#include <math.h>
+#include <stdint.h>
 
 /// Implementation of the HumiditySensor interface for the DHT22/AM2302 sensor.
+///
+/// The pulse train of the sensor is captured by a pin-change interrupt and decoded in the background, instead of being
+/// bit-banged with interrupts disabled: requestSample() sends the start signal, and readSample() decodes the frame as
+/// soon as all its edges have been received (about 5 ms later), or gives up on it after frameTimeout. Only one
+/// instance is supported, since the interrupt handler is static.
 class DHTHumiditySensor {
 private:
-	DHT &dht;
+	static DHTHumiditySensor *instance; //!< Instance served by the interrupt handler
+
+	static constexpr uint16_t startTime = 1100; //!< Duration of the start signal (in micros)
+	static constexpr uint8_t bitThreshold = 50; //!< High pulses longer than this encode a 1 (in micros)
+	static constexpr uint8_t nFrameEdges = 42;  //!< Number of falling edges in a complete frame
+	static constexpr uint8_t frameTimeout = 10; //!< Time after which an incomplete frame is given up (in millis)
+
+public:
+	static constexpr double noiseVariance = 0.25; //!< Noise variance of the humidity (in percentage points squared)
+
+private:
+
+	const uint8_t pin;
+
+	///@{
+	/// Frame being received (written from the interrupt handler)
+	volatile uint8_t frame[5];
+	volatile uint8_t nEdges;         //!< Number of falling edges since the start signal
+	volatile unsigned long lastRise; //!< Time of the last rising edge (in micros)
+	///@}
+
+	bool requested = false;        //!< Whether a frame has been requested
+	unsigned long requestTime = 0; //!< Time at which the frame was requested (in millis)
+	bool fresh = false;            //!< Whether the last decoded frame yielded a new sample
+	uint16_t checksumFailures = 0;
+
+	double t = NAN, h = NAN;
+
+	/// Interrupt handler: time the high pulses, and shift in a bit on every falling edge.
+	static void onEdge();
+
+	/// Decode the received frame. On an incomplete frame or a checksum failure, the humidity and temperature are set
+	/// to NaN.
+	void decode();
+
 public:
-	explicit DHTHumiditySensor(DHT *dht);
+	/// Constructor.
+	/// \param pin Data pin
+	explicit DHTHumiditySensor(uint8_t pin);
 	double getHumidity() const;
 	double getTemperature() const;
 	void begin();
-	void readSample();
+
+	/// Request a frame by sending the start signal, and start capturing the response.
+	void requestSample();
+
+	/// Decode the requested frame, once it has been received completely or has timed out. On an incomplete frame or a
+	/// checksum failure, the humidity and temperature are set to NaN.
+	/// \return True if the frame has been decoded (or has failed), false if it is pending or none was requested
+	bool readSample();
+
+	/// Whether the last decoded frame yielded a new (valid) sample.
+	/// \return True if fresh
+	[[nodiscard]] bool isFresh() const;
+
+	/// Get the number of frames that failed the checksum.
+	/// \return Number of checksum failures
+	[[nodiscard]] uint16_t getChecksumFailures() const;
 };
 
 
@@ -1,18 +1,38 @@
 #include <Arduino.h>
 
 #include "FlowSensor.h"
-#include "imath.h"
 
-FlowSensor::FlowSensor(uint8_t pin) : pin(pin) {}
+/// Flowrate for every ADC value, as the underlying integers of q16_16 numbers.
+struct FlowTable {
+	int32_t raw[FlowSensor::tableSize];
+};
+
+/// Generate the flowrate table from the polynomial approximation.
+/// \return Table
+static constexpr FlowTable makeFlowTable() {
+	FlowTable table{};
+	for (uint16_t i = 0; i < FlowSensor::tableSize; i++)
+		table.raw[i] = q16_16(FlowSensor::polynomial(i)).getRaw();
+	return table;
+}
+
+static constexpr FlowTable flowTable PROGMEM = makeFlowTable();
+
+FlowSensor::FlowSensor(ADCScanner *adc, uint8_t pin) : adc(*adc), channel(adc->add(pin)) {}
 
 double FlowSensor::readFlowrate() const {
-	double value = analogRead(pin);
-
-	// Calculate flowrate from voltage using polynomial approximation
-	return ( coeffs[0] * ipow(value, 5)
-	       + coeffs[1] * ipow(value, 4)
-	       + coeffs[2] * ipow(value, 3)
-	       + coeffs[3] * ipow(value, 2)
-	       + coeffs[4] * value
-	       + coeffs[5]);
+	return static_cast<double>(lookup(adc.read(channel)));
+}
+
+q16_16 FlowSensor::lookup(uint16_t value) {
+	constexpr uint8_t bits = ADCScanner::extraBits;
+	uint16_t i = value >> bits;
+	if (i >= tableSize - 1)
+		return q16_16::fromRaw(static_cast<int32_t>(pgm_read_dword(&flowTable.raw[tableSize - 1])));
+
+	// Interpolate between the entries using the fractional bits
+	q16_16 a = q16_16::fromRaw(static_cast<int32_t>(pgm_read_dword(&flowTable.raw[i])));
+	q16_16 b = q16_16::fromRaw(static_cast<int32_t>(pgm_read_dword(&flowTable.raw[i + 1])));
+	q16_16 frac = q16_16::fromRaw(static_cast<int32_t>(value & ((1 << bits) - 1)) << (16 - bits));
+	return a + (b - a) * frac;
 }
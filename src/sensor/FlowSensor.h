@@ -4,11 +4,17 @@
 #include <stdint.h>
 
 #include "imath.h"
+#include "ADCScanner.h"
+#include "../Fixed.h"
 
 /// Read flow rate using a Omron D6F-P0010 MEMS flow sensor.
+/// The flowrate of every possible (10-bit) ADC value is tabulated at compile time, in fixed point, and stored in flash,
+/// so that reading the sensor takes a table lookup instead of evaluating the polynomial. The extra bits of the
+/// oversampled ADC value are used to interpolate between the entries.
 class FlowSensor {
 private:
-	const uint8_t pin;
+	const ADCScanner &adc; //!< Reference to the ADCScanner instance
+	const uint8_t channel; //!< ADC channel of the sensor pin
 	/// Coefficients of the polynomial approximation to the sensor response (and voltage mapping)
 	static constexpr double coeffs[] = {
 			 0.094003 * ipow(3.3 / 1023, 5),
@@ -20,13 +26,29 @@ private:
 	};
 
 public:
+	static constexpr uint16_t tableSize = 1024; //!< Number of possible ADC values
+
 	/// Constructor.
+	/// \param adc Pointer to the ADCScanner instance
 	/// \param pin Sensor pin number
-	explicit FlowSensor(uint8_t pin);
+	FlowSensor(ADCScanner *adc, uint8_t pin);
 
 	/// Read the flow rate.
 	/// \return flow rate (L/min)
 	double readFlowrate() const;
+
+	/// Calculate the flowrate from an ADC value using the table.
+	/// \param value ADC value, with ADCScanner::extraBits fractional bits
+	/// \return flow rate (L/min)
+	static q16_16 lookup(uint16_t value);
+
+	/// Calculate the flowrate from an ADC value using the polynomial approximation. This is what the table is
+	/// generated from, and can be used to check its accuracy.
+	/// \param x ADC value (0-1023)
+	/// \return flow rate (L/min)
+	static constexpr double polynomial(double x) {
+		return ((((coeffs[0] * x + coeffs[1]) * x + coeffs[2]) * x + coeffs[3]) * x + coeffs[4]) * x + coeffs[5];
+	}
 };
 
 
@@ -0,0 +1,191 @@
+#ifndef HUMIDISTAT_FUSEDHUMIDITYSENSOR_H
+#define HUMIDISTAT_FUSEDHUMIDITYSENSOR_H
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdint.h>
+
+#include CONFIG_HEADER
+
+/// List of references to sensors of (possibly) different types, which can be iterated over at compile time.
+/// \tparam Sensors Sensor types
+template<class... Sensors>
+class SensorRefs;
+
+template<>
+class SensorRefs<> {
+public:
+	template<class F>
+	void forEach(F &&, uint8_t = 0) {}
+};
+
+template<class Sensor, class... Rest>
+class SensorRefs<Sensor, Rest...> {
+private:
+	Sensor &sensor;
+	SensorRefs<Rest...> rest;
+
+public:
+	/// Constructor.
+	/// \param sensor Pointer to the first sensor
+	/// \param rest   Pointers to the other sensors
+	explicit SensorRefs(Sensor *sensor, Rest *...rest) : sensor(*sensor), rest(rest...) {}
+
+	/// Call a function on every sensor.
+	/// \param f Function (typically a generic lambda) taking a reference to the sensor and its index
+	/// \param i Index of the first sensor
+	template<class F>
+	void forEach(F &&f, uint8_t i = 0) {
+		f(sensor, i);
+		rest.forEach(f, i + 1);
+	}
+};
+
+/// Implementation of the HumiditySensor interface that fuses the readings of several humidity sensors, for redundancy.
+/// The sensors are cross-checked: the readings that disagree with the majority by more than FS_tolerance are
+/// discarded (between two sensors that disagree, the one closest to the previous humidity is kept), and the remaining
+/// ones are averaged, weighted by the inverse of the noise variance of each sensor type. A sensor that has not returned
+/// a valid reading within FS_timeout drops out, so that the fused humidity fails over to the remaining sensors, and
+/// only becomes NaN when all of them have failed.
+///
+/// The sensors are held by reference and read in turn: there are no virtual methods involved, so that this class can be
+/// used as HumiditySensor in aliases.h like any single sensor. Every sensor type must have a static constexpr member
+/// noiseVariance.
+/// \tparam Sensors Sensor types (at most 8)
+template<class... Sensors>
+class FusedHumiditySensor {
+private:
+	static constexpr uint8_t n = sizeof...(Sensors);
+	static_assert(n >= 1 && n <= 8, "FusedHumiditySensor fuses 1 to 8 sensors");
+
+	/// Noise variance of each sensor (in percentage points squared)
+	static constexpr double variances[n] = {Sensors::noiseVariance...};
+
+	/// Last valid reading of a sensor
+	struct Reading {
+		double h = NAN, t = NAN;
+		unsigned long time = 0; //!< Time of the reading (in millis)
+	};
+
+	SensorRefs<Sensors...> sensors;
+	Reading readings[n];
+	uint8_t used = 0;    //!< Bitmask of the sensors used in the fused reading
+	uint8_t pending = 0; //!< Bitmask of the sensors whose requested sample has not been read yet
+
+	double t = NAN, h = NAN;
+
+	/// Cross-check the recent readings, and average the ones that agree.
+	/// \param now Current time (in millis)
+	void fuse(unsigned long now) {
+		// Sensors with a recent reading, and the number of these that agree with each of them
+		uint8_t recent = 0;
+		uint8_t agreeing[n]{};
+		for (uint8_t i = 0; i < n; i++)
+			if (!isnan(readings[i].h) && now - readings[i].time <= config::FS_timeout)
+				recent |= 1 << i;
+		for (uint8_t i = 0; i < n; i++) {
+			if (!(recent & 1 << i))
+				continue;
+			for (uint8_t j = 0; j < n; j++)
+				if ((recent & 1 << j) && fabs(readings[i].h - readings[j].h) <= config::FS_tolerance)
+					agreeing[i]++;
+		}
+
+		// Pick a reference among the sensors agreeing with the most others: the one closest to the previous humidity,
+		// or else the least noisy one
+		int8_t ref = -1;
+		for (uint8_t i = 0; i < n; i++) {
+			if (!(recent & 1 << i))
+				continue;
+			if (ref < 0 || agreeing[i] > agreeing[ref]) {
+				ref = i;
+			} else if (agreeing[i] == agreeing[ref]) {
+				if (isnan(h) ? variances[i] < variances[ref]
+				             : fabs(readings[i].h - h) < fabs(readings[ref].h - h))
+					ref = i;
+			}
+		}
+
+		used = 0;
+		if (ref < 0) {
+			t = h = NAN;
+			return;
+		}
+
+		// Average the sensors agreeing with the reference, weighted by the inverse of their variance
+		double sumW = 0, sumH = 0, sumT = 0;
+		for (uint8_t i = 0; i < n; i++) {
+			if (!(recent & 1 << i) || fabs(readings[i].h - readings[ref].h) > config::FS_tolerance)
+				continue;
+			used |= 1 << i;
+			double w = 1 / variances[i];
+			sumW += w;
+			sumH += w * readings[i].h;
+			sumT += w * readings[i].t;
+		}
+		h = sumH / sumW;
+		t = sumT / sumW;
+	}
+
+public:
+	/// Constructor.
+	/// \param sensors Pointers to the sensor instances
+	explicit FusedHumiditySensor(Sensors *...sensors) : sensors(sensors...) {}
+
+	double getHumidity() const {
+		return h;
+	}
+
+	double getTemperature() const {
+		return t;
+	}
+
+	void begin() {
+		sensors.forEach([](auto &sensor, uint8_t) {
+			sensor.begin();
+		});
+	}
+
+	/// Request a sample from every sensor.
+	void requestSample() {
+		sensors.forEach([](auto &sensor, uint8_t) {
+			sensor.requestSample();
+		});
+		pending = (1 << n) - 1;
+	}
+
+	/// Read the requested samples of the sensors that have them ready, and fuse the readings once every sensor has
+	/// been read.
+	/// \return True if the readings have been fused, false if a sample is pending or none was requested
+	bool readSample() {
+		if (!pending)
+			return false;
+
+		unsigned long now = millis();
+		sensors.forEach([this, now](auto &sensor, uint8_t i) {
+			if (!(pending & 1 << i) || !sensor.readSample())
+				return;
+			pending &= ~(1 << i);
+			if (!isnan(sensor.getHumidity())) {
+				readings[i].h = sensor.getHumidity();
+				readings[i].t = sensor.getTemperature();
+				readings[i].time = now;
+			}
+		});
+		if (pending)
+			return false;
+
+		fuse(now);
+		return true;
+	}
+
+	/// Get the sensors used in the fused reading (as of the last fused readSample()): those that have a recent reading
+	/// that agrees with the others.
+	/// \return Bitmask (bit i for sensor i)
+	[[nodiscard]] uint8_t getUsed() const {
+		return used;
+	}
+};
+
+
+#endif //HUMIDISTAT_FUSEDHUMIDITYSENSOR_H
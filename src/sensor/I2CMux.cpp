@@ -0,0 +1,11 @@
+#include <Wire.h>
+
+#include "I2CMux.h"
+
+I2CMux::I2CMux(uint8_t address) : address(address) {}
+
+void I2CMux::select(uint8_t channel) const {
+	Wire.beginTransmission(address);
+	Wire.write(1 << channel);
+	Wire.endTransmission();
+}
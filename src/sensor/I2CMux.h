@@ -0,0 +1,22 @@
+#ifndef HUMIDISTAT_I2CMUX_H
+#define HUMIDISTAT_I2CMUX_H
+
+#include <stdint.h>
+
+/// TCA9548A I2C multiplexer, which allows multiple sensors with the same I2C address (such as the SHT85) on one bus.
+class I2CMux {
+private:
+	const uint8_t address;
+
+public:
+	/// Constructor.
+	/// \param address I2C address of the multiplexer
+	explicit I2CMux(uint8_t address);
+
+	/// Select a channel (connect it to the bus), deselecting all others.
+	/// \param channel Channel (0-7)
+	void select(uint8_t channel) const;
+};
+
+
+#endif //HUMIDISTAT_I2CMUX_H
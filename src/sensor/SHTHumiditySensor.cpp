@@ -1,6 +1,10 @@
+#include <Arduino.h>
+#include <Wire.h>
+
+#include CONFIG_HEADER
 #include "SHTHumiditySensor.h"
 
-SHTHumiditySensor::SHTHumiditySensor(SHTSensor *sht) : sht(*sht) {}
+SHTHumiditySensor::SHTHumiditySensor(const I2CMux *mux, uint8_t channel) : mux(mux), channel(channel) {}
 
 double SHTHumiditySensor::getHumidity() const {
 	return h;
@@ -12,11 +16,79 @@ double SHTHumiditySensor::getTemperature() const {
 
 void SHTHumiditySensor::begin() {
 	Wire.begin();
-	sht.init();
+	Wire.setClock(config::I2C_clock);
+	select();
+	send(cmdSoftReset);
+	delay(2);
+	state = State::idle;
+}
+
+bool SHTHumiditySensor::readSample() {
+	switch (state) {
+		case State::measuring:
+			if (millis() - triggered < conversionTime)
+				return false;
+			collect();
+			return true;
+		case State::failed:
+			state = State::idle;
+			return true;
+		default:
+			return false;
+	}
+}
+
+void SHTHumiditySensor::select() const {
+	if (mux != nullptr)
+		mux->select(channel);
+}
+
+bool SHTHumiditySensor::send(uint16_t command) const {
+	Wire.beginTransmission(address);
+	Wire.write(command >> 8);
+	Wire.write(command & 0xFF);
+	return Wire.endTransmission() == 0;
+}
+
+void SHTHumiditySensor::requestSample() {
+	select();
+	if (send(cmdMeasure)) {
+		state = State::measuring;
+		triggered = millis();
+	} else {
+		// The sensor does not respond: there is no valid reading
+		state = State::failed;
+		t = h = NAN;
+	}
+}
+
+void SHTHumiditySensor::collect() {
+	state = State::idle;
+	t = h = NAN;
+
+	select();
+	uint8_t data[6];
+	if (Wire.requestFrom(address, static_cast<uint8_t>(6)) != 6)
+		return;
+	for (uint8_t &byte : data)
+		byte = Wire.read();
+
+	// Temperature word, humidity word, each followed by its checksum
+	if (crc(&data[0]) != data[2] || crc(&data[3]) != data[5])
+		return;
+
+	uint16_t rawT = data[0] << 8 | data[1];
+	uint16_t rawH = data[3] << 8 | data[4];
+	t = -45 + 175 * (rawT / 65535.);
+	h = 100 * (rawH / 65535.);
 }
 
-void SHTHumiditySensor::readSample() {
-	sht.readSample();
-	t = sht.getTemperature();
-	h = sht.getHumidity();
+uint8_t SHTHumiditySensor::crc(const uint8_t *data) {
+	uint8_t crc = 0xFF;
+	for (uint8_t i = 0; i < 2; i++) {
+		crc ^= data[i];
+		for (uint8_t bit = 0; bit < 8; bit++)
+			crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+	}
+	return crc;
 }
@@ -2,21 +2,74 @@
 #define HUMIDISTAT_SHTHUMIDITYSENSOR_H
 
 #include <math.h>
-#include <Wire.h>
-#include <SHTSensor.h>
+#include <stdint.h>
+
+#include "I2CMux.h"
 
 /// Implementation of the HumiditySensor interface for the Sensirion SHT85 sensor.
+/// Optionally, the sensor can be connected through an I2C multiplexer.
+///
+/// The sensor is read in a split-phase manner, so that the main loop never waits for a conversion: requestSample()
+/// triggers a measurement, and readSample() collects its result once the conversion has finished. Only the short I2C
+/// transfers themselves are blocking.
 class SHTHumiditySensor {
 private:
-	SHTSensor &sht;
+	enum class State : uint8_t {
+		idle,
+		measuring,
+		failed, //!< The sensor did not acknowledge the trigger
+	};
+
+	static constexpr uint8_t address = 0x44;         //!< I2C address of the SHT85
+	static constexpr uint16_t cmdMeasure = 0x2400;   //!< Single shot, high repeatability, no clock stretching
+	static constexpr uint16_t cmdSoftReset = 0x30A2; //!< Soft reset
+	static constexpr uint8_t conversionTime = 16;    //!< Maximum conversion time (in ms)
+
+public:
+	static constexpr double noiseVariance = 0.01; //!< Noise variance of the humidity (in percentage points squared)
+
+private:
+
+	const I2CMux *const mux;
+	const uint8_t channel;
+
+	State state = State::idle;
+	unsigned long triggered = 0; //!< Time at which the last measurement was triggered (in millis)
 
 	double t = NAN, h = NAN;
+
+	/// Select the channel of the multiplexer (if any).
+	void select() const;
+
+	/// Send a command to the sensor.
+	/// \param command Command
+	/// \return True if the sensor acknowledged
+	bool send(uint16_t command) const;
+
+	/// Collect the result of a measurement. On a bus or CRC error, the humidity and temperature are set to NaN.
+	void collect();
+
+	/// Calculate the CRC-8 checksum of a word (polynomial 0x31, initialisation 0xFF).
+	/// \param data Pointer to 2 bytes
+	/// \return Checksum
+	static uint8_t crc(const uint8_t *data);
+
 public:
-	explicit SHTHumiditySensor(SHTSensor *sht);
+	/// Constructor.
+	/// \param mux     Pointer to an I2CMux instance, or nullptr if the sensor is connected directly
+	/// \param channel Channel of the multiplexer the sensor is connected to
+	explicit SHTHumiditySensor(const I2CMux *mux = nullptr, uint8_t channel = 0);
 	double getHumidity() const;
 	double getTemperature() const;
 	void begin();
-	void readSample();
+
+	/// Trigger a measurement.
+	void requestSample();
+
+	/// Collect the requested measurement, if its conversion has finished. On a bus or CRC error, the humidity and
+	/// temperature are set to NaN.
+	/// \return True if the measurement has been collected (or has failed), false if it is pending or none was requested
+	bool readSample();
 };
 
 
@@ -0,0 +1,18 @@
+#include <math.h>
+
+#include "ThermistorBank.h"
+
+ThermistorBank::ThermistorBank(etl::span<const ThermistorReader, size> trs) : trs(trs) {
+	for (double &temp : temps)
+		temp = NAN;
+}
+
+void ThermistorBank::update() {
+	uint16_t ref = trs[0].readReference();
+	for (uint8_t i = 0; i < size; i++)
+		temps[i] = trs[i].readTemp(ref);
+}
+
+double ThermistorBank::getTemp(uint8_t i) const {
+	return temps[i];
+}
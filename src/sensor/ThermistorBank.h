@@ -0,0 +1,34 @@
+#ifndef HUMIDISTAT_THERMISTORBANK_H
+#define HUMIDISTAT_THERMISTORBANK_H
+
+#include <stdint.h>
+#include <etl/span.h>
+
+#include "ThermistorReader.h"
+
+/// Bank of thermistors that share a reference voltage. update() reads the reference once for all of them, and caches
+/// the temperatures, so that the UI and logger need not convert them themselves.
+class ThermistorBank {
+public:
+	static constexpr uint8_t size = 4; //!< Number of thermistors
+
+private:
+	const etl::span<const ThermistorReader, size> trs;
+	double temps[size];
+
+public:
+	/// Constructor.
+	/// \param trs Span over 4 ThermistorReader instances
+	explicit ThermistorBank(etl::span<const ThermistorReader, size> trs);
+
+	/// Read the reference voltage and the temperatures of all thermistors. Call this periodically from the main loop.
+	void update();
+
+	/// Get the temperature of a thermistor (as of the last update()).
+	/// \param i Thermistor index
+	/// \return Temperature (Celsius), or NaN if out of range (or not read yet)
+	[[nodiscard]] double getTemp(uint8_t i) const;
+};
+
+
+#endif //HUMIDISTAT_THERMISTORBANK_H
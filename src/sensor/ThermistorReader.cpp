@@ -1,14 +1,54 @@
 #include <Arduino.h>
 #include "ThermistorReader.h"
+#include "../Fixed.h"
 
-ThermistorReader::ThermistorReader(uint8_t pin) : pin(pin) {}
+static constexpr uint16_t segments = 1 << ThermistorReader::tableBits; //!< Number of table segments
 
-double ThermistorReader::getThermistorResistance() const {
-	// Read temperature using reference 3.3V on A5 pin
-	double V_NTC = analogRead(pin) / static_cast<double>(analogRead(ref_pin));
-	return R_series * (1 / V_NTC - 1);
+/// Temperature at the boundaries of the table segments, as the underlying integers of q16_16 numbers.
+struct NTCTable {
+	int32_t raw[segments + 1];
+};
+
+/// Generate the temperature table from the thermistor equation. The outer entries (at ratios of 0 and 1) are unused.
+/// \return Table
+static constexpr NTCTable makeNTCTable() {
+	NTCTable table{};
+	for (uint16_t i = 1; i < segments; i++)
+		table.raw[i] = q16_16(ThermistorReader::exactTemperature(static_cast<double>(i) / segments)).getRaw();
+	return table;
+}
+
+static constexpr NTCTable ntcTable PROGMEM = makeNTCTable();
+
+ThermistorReader::ThermistorReader(ADCScanner *adc, uint8_t pin)
+		: adc(*adc), channel(adc->add(pin)), refChannel(adc->add(ref_pin)) {}
+
+uint16_t ThermistorReader::readReference() const {
+	// Reference 3.3V on A5 pin
+	return adc.read(refChannel);
 }
 
 double ThermistorReader::readTemp() const {
-	return B / log(getThermistorResistance() / r_inf) - 273;
+	return readTemp(readReference());
+}
+
+double ThermistorReader::readTemp(uint16_t ref) const {
+	return temperature(adc.read(channel), ref);
+}
+
+double ThermistorReader::temperature(uint16_t value, uint16_t ref) {
+	if (ref == 0)
+		return NAN;
+
+	// Voltage ratio with 16 fractional bits, split into the segment and the position within it
+	constexpr uint8_t shift = 16 - tableBits;
+	uint32_t ratio = (static_cast<uint32_t>(value) << 16) / ref;
+	uint32_t i = ratio >> shift;
+	if (i < 1 || i > segments - 2)
+		return NAN;
+
+	q16_16 a = q16_16::fromRaw(static_cast<int32_t>(pgm_read_dword(&ntcTable.raw[i])));
+	q16_16 b = q16_16::fromRaw(static_cast<int32_t>(pgm_read_dword(&ntcTable.raw[i + 1])));
+	q16_16 frac = q16_16::fromRaw(static_cast<int32_t>(ratio & ((1UL << shift) - 1)) << tableBits);
+	return static_cast<double>(a + (b - a) * frac);
 }
@@ -3,26 +3,60 @@
 
 #include <stdint.h>
 
+#include "imath.h"
+#include "ADCScanner.h"
+
 /// Driver for thermistor thermometers.
+/// The temperature is interpolated from a table indexed by the ratio of the NTC and reference voltages, which is
+/// generated at compile time from the thermistor equation. The reference voltage can be read once for a number of
+/// thermistors (see ThermistorBank).
 class ThermistorReader {
 private:
-	const uint8_t ref_pin = 5;     //!< Reference (high) voltage pin number
-	const uint8_t pin;             //!< NTC pin number
-	const double R_series = 10000; //!< Resistance of R2 in voltage divider (Ohm)
-	const double B = 3950;         //!< Thermistor's value of B in the thermistor equation (K)
-	const double r_inf = 0.01752;  //!< Thermistor's value of R_inf in the thermistor equation (Ohm)
-
-	/// Calculate the resistance of the thermistor in the voltage divider.
-	/// \return Resistance (Ohm)
-	double getThermistorResistance() const;
+	static constexpr uint8_t ref_pin = 5;     //!< Reference (high) voltage pin number
+	static constexpr double R_series = 10000; //!< Resistance of R2 in voltage divider (Ohm)
+	static constexpr double B = 3950;         //!< Thermistor's value of B in the thermistor equation (K)
+	static constexpr double r_inf = 0.01752;  //!< Thermistor's value of R_inf in the thermistor equation (Ohm)
+
+	const ADCScanner &adc;    //!< Reference to the ADCScanner instance
+	const uint8_t channel;    //!< ADC channel of the NTC pin
+	const uint8_t refChannel; //!< ADC channel of the reference pin
+
 public:
+	/// The table has 2^tableBits segments, equally spaced in the voltage ratio. Ratios in the first and last segment
+	/// (temperatures below about -45 or above 160 Celsius) are out of range.
+	static constexpr uint8_t tableBits = 6;
+
 	/// Constructor.
+	/// \param adc Pointer to the ADCScanner instance
 	/// \param pin NTC pin number
-	explicit ThermistorReader(uint8_t pin);
+	ThermistorReader(ADCScanner *adc, uint8_t pin);
+
+	/// Read the reference voltage.
+	/// \return ADC value (with ADCScanner::extraBits fractional bits)
+	[[nodiscard]] uint16_t readReference() const;
 
-	/// Get the temperature of the thermistor.
+	/// Get the temperature of the thermistor (reading the reference voltage as well).
 	/// \return Temperature (Celsius)
 	double readTemp() const;
+
+	/// Get the temperature of the thermistor, given the reference voltage.
+	/// \param ref ADC value of the reference voltage (see readReference())
+	/// \return Temperature (Celsius), or NaN if out of range
+	double readTemp(uint16_t ref) const;
+
+	/// Calculate the temperature from the ADC values of the NTC and reference voltages, using the table.
+	/// \param value ADC value of the NTC voltage
+	/// \param ref   ADC value of the reference voltage (with the same number of fractional bits)
+	/// \return Temperature (Celsius), or NaN if out of range
+	static double temperature(uint16_t value, uint16_t ref);
+
+	/// Calculate the temperature from the voltage ratio using the thermistor equation. This is what the table is
+	/// generated from, and can be used to check its accuracy.
+	/// \param ratio Ratio of the NTC and reference voltages (in (0, 1))
+	/// \return Temperature (Celsius)
+	static constexpr double exactTemperature(double ratio) {
+		return B / ln(R_series * (1 / ratio - 1) / r_inf) - 273;
+	}
 };
 
 
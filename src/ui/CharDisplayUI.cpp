@@ -1,8 +1,8 @@
 #include "CharDisplayUI.h"
 
 CharDisplayUI::CharDisplayUI(LiquidCrystal *liquidCrystal, const ButtonReader *buttonReader,
-                             SingleHumidistat *humidistat, etl::span<const ThermistorReader, 4> trs)
-		: ControllerUI(liquidCrystal, buttonReader, trs), liquidCrystal(*liquidCrystal), humidistat(*humidistat) {}
+                             SingleHumidistat *humidistat, const ThermistorBank *thermistors)
+		: ControllerUI(liquidCrystal, buttonReader, thermistors), liquidCrystal(*liquidCrystal), humidistat(*humidistat) {}
 
 void CharDisplayUI::draw() {
 	lastRefreshed = millis();
@@ -30,7 +30,7 @@ void CharDisplayUI::draw() {
 	liquidCrystal.print(humidistat.active);
 
 	// Thermistors
-	for (size_t i = 0; i < trs.size(); ++i) {
+	for (uint8_t i = 0; i < ThermistorBank::size; ++i) {
 		printNTC(3 * i, 1, i);
 	}
 }
@@ -28,9 +28,9 @@ public:
 	/// \param liquidCrystal Pointer to a LiquidCrystal instance
 	/// \param buttonReader  Pointer to a ButtonReader instance
 	/// \param humidistat    Pointer to a SingleHumidistat instance
-	/// \param trs           Span over 4 ThermistorReader instances
+	/// \param thermistors   Pointer to a ThermistorBank instance
 	explicit CharDisplayUI(LiquidCrystal *liquidCrystal, const ButtonReader *buttonReader, SingleHumidistat *humidistat,
-	                       etl::span<const ThermistorReader, 4> trs);
+	                       const ThermistorBank *thermistors);
 
 	void begin() override;
 };
@@ -28,7 +28,7 @@ public:
 		///@{
 		/// Constructor.
 		/// \param par Pointer to the variable
-		Var(uint8_t *par) : type(ConfigParType::ui16), ui8(par) {}
+		Var(uint8_t *par) : type(ConfigParType::ui8), ui8(par) {}
 		Var(uint16_t *par) : type(ConfigParType::ui16), ui16(par) {}
 		Var(double *par) : type(ConfigParType::d), d(par) {}
 		///@}
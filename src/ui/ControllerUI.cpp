@@ -1,7 +1,7 @@
 #include "ControllerUI.h"
 
-ControllerUI::ControllerUI(Print *display, const ButtonReader *buttonReader, etl::span<const ThermistorReader, 4> trs)
-	: display(*display), buttonReader(*buttonReader), trs(trs) {}
+ControllerUI::ControllerUI(Print *display, const ButtonReader *buttonReader, const ThermistorBank *thermistors)
+	: display(*display), buttonReader(*buttonReader), thermistors(*thermistors) {}
 
 void ControllerUI::update() {
 	// Show splash screen and info (draw it once) for a short time after boot
@@ -56,7 +56,7 @@ void ControllerUI::blink(uint8_t col, uint8_t row, const char *buf) {
 }
 
 void ControllerUI::printNTC(uint8_t col, uint8_t row, uint8_t i) {
-	double temp = trs[i].readTemp();
+	double temp = thermistors.getTemp(i);
 	if (isnan(temp)) {
 		printf(col, row, "%2u", 0);
 	} else {
@@ -7,7 +7,7 @@
 
 #include CONFIG_HEADER
 #include "input/ButtonReader.h"
-#include "sensor/ThermistorReader.h"
+#include "sensor/ThermistorBank.h"
 #include "asprintf.h"
 
 /// User interface (display and input) for humidistat.
@@ -50,7 +50,7 @@ private:
 	virtual bool handleInput(Buttons state, uint16_t pressedFor) = 0;
 
 protected:
-	etl::span<const ThermistorReader, 4> trs;
+	const ThermistorBank &thermistors;
 
 	unsigned long lastRefreshed = 0; //!< Last time display was updated (in millis)
 
@@ -61,8 +61,8 @@ protected:
 	/// Constructor.
 	/// \param display      Pointer to a Print instance
 	/// \param buttonReader Pointer to a ButtonReader instance
-	/// \param trs          Span over 4 ThermistorReader instances
-	explicit ControllerUI(Print *display, const ButtonReader *buttonReader, etl::span<const ThermistorReader, 4> trs);
+	/// \param thermistors  Pointer to a ThermistorBank instance
+	explicit ControllerUI(Print *display, const ButtonReader *buttonReader, const ThermistorBank *thermistors);
 
 	/// Print blinking text.
 	/// \param col LCD column
@@ -73,7 +73,7 @@ protected:
 	/// Print temperature read from thermistors. Handles NaN values as 0
 	/// \param col LCD column
 	/// \param row LCD row
-	/// \param i   ThermistorReader index
+	/// \param i   Thermistor index
 	void printNTC(uint8_t col, uint8_t row, uint8_t i);
 
 	/// In-/de-crement a variable, while clipping it to [min, max].
@@ -4,6 +4,7 @@
 #include <U8g2lib.h>
 #include <SPI.h>
 #include <etl/span.h>
+#include <etl/type_traits.h>
 #undef abs
 #include <cmath>
 
@@ -42,9 +43,15 @@ private:
 	enum class Action {
 		save,
 		reset,
-		_last = reset
+		tune,
+		calibrate,
+		_last = calibrate
 	};
 
+	/// Whether the valves can be calibrated (this requires the flow sensors of the cascade controller)
+	static constexpr bool canCalibrate = config::valveLinearization &&
+	                                     etl::is_same<Humidistat_t, CascadeHumidistat>::value;
+
 	U8G2 &u8g2;
 	EEPROMConfig &eepromConfig;
 	Humidistat_t &humidistat;
@@ -64,8 +71,26 @@ private:
 	const uint16_t longPressDuration = config::longPressDuration;
 	const uint8_t configSaveCooldown = config::configSaveCooldown;
 
-	const uint8_t nConfigPars;     //!< Total number of config parameters
-	const ConfigPar configPars[13]; //!< Array of config parameters
+	const uint8_t nConfigPars;     //!< Number of config parameters shown
+	const uint8_t firstConfigPar;  //!< Index of the first config parameter shown
+	const ConfigPar configPars[22]; //!< Array of config parameters. The PID gains and timesteps come first, so that they
+	                                //!< can be skipped if they are compile-time constants (see staticGains).
+
+	/// Get a config parameter that is shown.
+	/// \param i Index (among the parameters shown)
+	/// \return Config parameter
+	const ConfigPar &configPar(uint8_t i) const {
+		return configPars[firstConfigPar + i];
+	}
+
+	/// Whether the valves are being calibrated.
+	/// \return True if calibrating
+	bool isCalibrating() const {
+		if constexpr (canCalibrate)
+			return humidistat.isCalibrating();
+		else
+			return false;
+	}
 
 	/// Draw the Main tab
 	// (declaration, implementation specialised)
@@ -93,7 +118,7 @@ private:
 		u8g2.drawHLine(0, 44, 128);
 
 		// Thermistors
-		for (size_t i = 0; i < trs.size(); ++i) {
+		for (uint8_t i = 0; i < ThermistorBank::size; ++i) {
 			printNTC(70 + 15*i, 43, i);
 		}
 
@@ -143,7 +168,7 @@ private:
 
 			uint8_t row = 22 + i * 10;
 
-			char *buf = configPars[nPar].asprint();
+			char *buf = configPar(nPar).asprint();
 			u8g2.drawStr(0, row, buf);
 			delete buf;
 
@@ -157,8 +182,8 @@ private:
 					x = 66 + currentDigit * 6;
 					// Take into account the decimal separator:
 					// if the current parameter is a float and we're left of the decimal separator, move one block left
-					if (configPars[currentPar].var.type == ConfigPar::ConfigParType::d &&
-					    currentDigit < configPars[currentPar].magnitude())
+					if (configPar(currentPar).var.type == ConfigPar::ConfigParType::d &&
+					    currentDigit < configPar(currentPar).magnitude())
 						x -= 6;
 					w = 6;
 				}
@@ -174,6 +199,9 @@ private:
 		// Actions
 		u8g2.drawStr(100, 32, "Save");
 		u8g2.drawStr(100, 42, "Reset");
+		u8g2.drawStr(100, 52, humidistat.isTuning() ? "Tuning" : "Tune");
+		if constexpr (canCalibrate)
+			u8g2.drawStr(100, 62, humidistat.isCalibrating() ? "Cal..." : "Cal");
 		if (currentSelection == Selection::actions) {
 			uint8_t y;
 			if (currentAction == Action::save) {
@@ -182,6 +210,12 @@ private:
 			if (currentAction == Action::reset) {
 				y = 42 - 8;
 			}
+			if (currentAction == Action::tune) {
+				y = 52 - 8;
+			}
+			if (currentAction == Action::calibrate) {
+				y = 62 - 8;
+			}
 
 			u8g2.setDrawColor(2);
 			u8g2.drawBox(100, y, 40, 10);
@@ -242,9 +276,17 @@ private:
 		u8g2.drawStr(57, 10, "C.");
 		u8g2.drawVLine(70, 1, 12);
 
-		// Humidity box
+		// Humidity box (while the setpoint is being ramped, the header shows the ramped setpoint, and when the sensor
+		// is stale or the dead time of the model is clamped, a warning)
 		u8g2.drawVLine(13, 27, 28);
-		u8g2.drawStr(0, 23, "Humidity");
+		if (humidistat.isSensorStale())
+			u8g2.drawStr(0, 23, "Stale!");
+		else if (humidistat.isDeadTimeClamped())
+			u8g2.drawStr(0, 23, "L > max");
+		else if (humidistat.active && abs(humidistat.getRampedSetpoint() - humidistat.sp) > 0.05)
+			printf(0, 23, "->%5.1f%%", humidistat.getRampedSetpoint());
+		else
+			u8g2.drawStr(0, 23, "Humidity");
 		u8g2.drawHLine(0, 26, 51);
 
 		u8g2.drawStr(0, 35, "PV");
@@ -276,7 +318,11 @@ private:
 		printf(20, 53, "%3.0f%%", humidistat.cv * 100);
 
 		// Mode
-		if (humidistat.active)
+		if (humidistat.isTuning())
+			u8g2.drawStr(80, 10, "tuning");
+		else if (isCalibrating())
+			u8g2.drawStr(80, 10, "calib.");
+		else if (humidistat.active)
 			u8g2.drawStr(80, 10, "auto");
 		else
 			u8g2.drawStr(80, 10, "manual");
@@ -426,11 +472,11 @@ private:
 			}
 			// Adjust digit up/down
 			if (state == Buttons::UP) {
-				configPars[currentPar].adjust(ipow(10, NUM_DECIMALS - currentDigit));
+				configPar(currentPar).adjust(ipow(10, NUM_DECIMALS - currentDigit));
 				return true;
 			}
 			if (state == Buttons::DOWN) {
-				configPars[currentPar].adjust(-ipow(10, NUM_DECIMALS - currentDigit));
+				configPar(currentPar).adjust(-ipow(10, NUM_DECIMALS - currentDigit));
 				return true;
 			}
 		} else if (currentSelection == Selection::actions) {
@@ -440,6 +486,8 @@ private:
 			}
 			if (state == Buttons::UP || state == Buttons::DOWN) {
 				advanceEnum(currentAction);
+				if (!canCalibrate && currentAction == Action::calibrate)
+					advanceEnum(currentAction);
 				return true;
 			}
 			if (state == Buttons::SELECT) {
@@ -455,6 +503,17 @@ private:
 					eepromConfig.reset();
 					return true;
 				}
+				if (currentAction == Action::tune) {
+					if (!humidistat.isTuning())
+						humidistat.startAutotune();
+					return true;
+				}
+				if constexpr (canCalibrate) {
+					if (currentAction == Action::calibrate) {
+						humidistat.startCalibration();
+						return true;
+					}
+				}
 			}
 		}
 	}
@@ -515,27 +574,36 @@ public:
 	/// \param u8g2         Pointer to a U8G2 instance
 	/// \param buttonReader Pointer to a ButtonReader instance
 	/// \param humidistat   Pointer to a Humidistat instance
-	/// \param trs          Span over 4 ThermistorReader instances
+	/// \param thermistors  Pointer to a ThermistorBank instance
 	/// \param eepromConfig Pointer to a EEPROMConfig instance
 	/// \param spr          Pointer to a SetpointProfileRunner instance
 	explicit GraphicalDisplayUI(U8G2 *u8g2, const ButtonReader *buttonReader, SingleHumidistat *humidistat,
-	                            etl::span<const ThermistorReader, 4> trs, EEPROMConfig *eepromConfig,
+	                            const ThermistorBank *thermistors, EEPROMConfig *eepromConfig,
 								SetpointProfileRunner *spr)
-			: ControllerUI(u8g2, buttonReader, trs), u8g2(*u8g2), eepromConfig(*eepromConfig),
-			  humidistat(*humidistat), spr(*spr), nConfigPars(6), configPars{
+			: ControllerUI(u8g2, buttonReader, thermistors), u8g2(*u8g2), eepromConfig(*eepromConfig),
+			  humidistat(*humidistat), spr(*spr), nConfigPars(config::staticGains ? 9 : 13),
+			  firstConfigPar(config::staticGains ? 4 : 0), configPars{
 					{&eepromConfig->configStore.HC_Kp,      "Kp"},
 					{&eepromConfig->configStore.HC_Ki,      "Ki"},
 					{&eepromConfig->configStore.HC_Kd,      "Kd"},
 					{&eepromConfig->configStore.dt,         "dt"},
+					{&eepromConfig->configStore.HC_b,       "b (%)"},
+					{&eepromConfig->configStore.HC_c,       "c (%)"},
+					{&eepromConfig->configStore.SP_rampRate, "SP rate"},
+					{&eepromConfig->configStore.SP_rampAccel, "SP accel"},
+					{&eepromConfig->configStore.HC_modelK, "Model K"},
+					{&eepromConfig->configStore.HC_modelTau, "Model T"},
+					{&eepromConfig->configStore.HC_modelL, "Model L"},
 					{&eepromConfig->configStore.S_lowValue, "LV"},
-					{&eepromConfig->configStore.a, "a"},
+					{&eepromConfig->configStore.HC_Tf, "Tf"},
 			} {}
 
 	explicit GraphicalDisplayUI(U8G2 *u8g2, const ButtonReader *buttonReader, CascadeHumidistat *humidistat,
-	                            etl::span<const ThermistorReader, 4> trs, EEPROMConfig *eepromConfig,
+	                            const ThermistorBank *thermistors, EEPROMConfig *eepromConfig,
 			                    SetpointProfileRunner *spr)
-			: ControllerUI(u8g2, buttonReader, trs), u8g2(*u8g2), eepromConfig(*eepromConfig),
-			  humidistat(*humidistat), spr(*spr), nConfigPars(13), configPars{
+			: ControllerUI(u8g2, buttonReader, thermistors), u8g2(*u8g2), eepromConfig(*eepromConfig),
+			  humidistat(*humidistat), spr(*spr), nConfigPars(config::staticGains ? 12 : 22),
+			  firstConfigPar(config::staticGains ? 10 : 0), configPars{
 					{&eepromConfig->configStore.HC_Kp, "HC Kp"},
 					{&eepromConfig->configStore.HC_Ki, "HC Ki"},
 					{&eepromConfig->configStore.HC_Kd, "HC Kd"},
@@ -544,11 +612,20 @@ public:
 					{&eepromConfig->configStore.FC_Ki, "FC Ki"},
 					{&eepromConfig->configStore.FC_Kd, "FC Kd"},
 					{&eepromConfig->configStore.FC_Kf, "FC Kf"},
+					{&eepromConfig->configStore.dt, "dt"},
 					{&eepromConfig->configStore.FC_dt, "FC dt"},
+					{&eepromConfig->configStore.HC_b, "HC b (%)"},
+					{&eepromConfig->configStore.HC_c, "HC c (%)"},
+					{&eepromConfig->configStore.SP_rampRate, "SP rate"},
+					{&eepromConfig->configStore.SP_rampAccel, "SP accel"},
+					{&eepromConfig->configStore.HC_modelK, "Model K"},
+					{&eepromConfig->configStore.HC_modelTau, "Model T"},
+					{&eepromConfig->configStore.HC_modelL, "Model L"},
+					{&eepromConfig->configStore.FC_b, "FC b (%)"},
+					{&eepromConfig->configStore.FC_c, "FC c (%)"},
 					{&eepromConfig->configStore.HC_totalFlowrate, "Total FR"},
-					{&eepromConfig->configStore.dt, "dt"},
 					{&eepromConfig->configStore.S_lowValue, "LV"},
-					{&eepromConfig->configStore.a, "a"},
+					{&eepromConfig->configStore.HC_Tf, "Tf"},
 			} {}
 	///@}
 
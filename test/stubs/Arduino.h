@@ -0,0 +1,47 @@
+#ifndef HUMIDISTAT_TEST_ARDUINO_H
+#define HUMIDISTAT_TEST_ARDUINO_H
+
+/// Minimal stand-in for the Arduino core, for running the platform-independent parts of the firmware on the host
+/// (pio test -e native). Time stands still, and interrupts are a no-op.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define A8 22
+#define A9 23
+#define A10 24
+#define A11 25
+#define A12 26
+#define A13 27
+
+#define PROGMEM
+#define pgm_read_dword(addr) (*reinterpret_cast<const uint32_t *>(addr))
+
+inline unsigned long millis() { return 0; }
+inline unsigned long micros() { return 0; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline int analogRead(uint8_t) { return 0; }
+
+/// Serial port that discards its output
+struct NullSerial {
+	template<class T>
+	size_t print(const T &) { return 0; }
+	template<class T>
+	size_t println(const T &) { return 0; }
+	size_t println() { return 0; }
+};
+inline NullSerial Serial;
+
+#endif //HUMIDISTAT_TEST_ARDUINO_H
@@ -0,0 +1,227 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "control/Controller.h"
+
+/// Relay experiment on a simulated first-order-plus-dead-time (FOPDT) plant, checked against the analytic limit cycle.
+
+/// FOPDT model of the chamber, discretised exactly for a zero-order hold on the input: the humidity approaches K * u
+/// with time constant tau, after a dead time L.
+struct Plant {
+	static constexpr uint16_t dt = 250;  //!< Timestep (in ms)
+	static constexpr uint16_t delay = 40; //!< Dead time (in timesteps)
+
+	double K = 100;  //!< Gain (in percentage points per unit of cv)
+	double tau = 60; //!< Time constant (in s)
+	double y = 50;   //!< Humidity (in percent)
+
+	double inputs[delay]; //!< Ring buffer of the delayed inputs
+	uint16_t head = 0;
+
+	/// Constructor.
+	/// \param u0 Initial (steady-state) input
+	explicit Plant(double u0) {
+		for (double &u : inputs)
+			u = u0;
+	}
+
+	/// Dead time (in s)
+	static constexpr double L = delay * dt / 1000.;
+
+	/// Advance the model by one timestep.
+	/// \param u Control variable
+	void step(double u) {
+		double a = exp(-dt / 1000. / tau);
+		y = a * y + (1 - a) * K * inputs[head];
+		inputs[head] = u;
+		head = (head + 1) % delay;
+	}
+};
+
+/// Ultimate gain and period of the plant as estimated by the relay experiment: the describing function of the relay,
+/// applied to the exact limit cycle. After the relay switches (at sp ± eps), the humidity keeps moving towards the
+/// steady state for the dead time, overshooting to the amplitude a, and then relaxes towards the opposite steady state
+/// until it reaches the other switching point.
+/// \param K   Plant gain
+/// \param tau Plant time constant (in s)
+/// \param L   Plant dead time (in s)
+/// \param d   Relay amplitude
+/// \param eps Hysteresis
+/// \param Ku  Ultimate gain
+/// \param Tu  Ultimate period (in s)
+void relayLimitCycle(double K, double tau, double L, double d, double eps, double &Ku, double &Tu) {
+	double Kd = K * d;
+	double a = Kd - (Kd - eps) * exp(-L / tau);
+	Ku = 4 * d / (M_PI * sqrt(a * a - eps * eps));
+	Tu = 2 * (L + tau * log((a + Kd) / (Kd - eps)));
+}
+
+/// Actual ultimate gain and period of the plant: the phase crossover of its frequency response.
+/// \param K   Plant gain
+/// \param tau Plant time constant (in s)
+/// \param L   Plant dead time (in s)
+/// \param Ku  Ultimate gain
+/// \param Tu  Ultimate period (in s)
+void phaseCrossover(double K, double tau, double L, double &Ku, double &Tu) {
+	// Solve atan(w * tau) + w * L = pi by bisection
+	double lo = 0, hi = M_PI / L;
+	for (uint8_t i = 0; i < 60; i++) {
+		double w = (lo + hi) / 2;
+		if (atan(w * tau) + w * L < M_PI)
+			lo = w;
+		else
+			hi = w;
+	}
+	Ku = sqrt(1 + lo * tau * lo * tau) / K;
+	Tu = 2 * M_PI / lo;
+}
+
+/// Controller exposing the relay experiment, as run by a humidistat: start it from the main loop, step it from the
+/// tick, and write the gains into the ConfigStore when it has finished.
+class TestController : public Controller<HCGains> {
+public:
+	explicit TestController(ConfigStore *cs)
+		: Controller<HCGains>(cs, cs->HC_Kp, cs->HC_Ki, cs->HC_Kd, cs->HC_Kf, cs->dt, 0, 1, cs->HC_Tf, 50, 0.5) {}
+
+	void start() {
+		startAutotune(config::HC_AT_hysteresis, Plant::dt);
+	}
+
+	/// Run a tick of the relay experiment on the plant.
+	/// \return True if the experiment is running
+	bool step(Plant &plant) {
+		tickState.pv = plant.y;
+		bool running = runAutotune();
+		plant.step(tickState.cv);
+		return running;
+	}
+
+	RelayAutotuner::State finish() {
+		return finishAutotune(cs.HC_Kp, cs.HC_Ki, cs.HC_Kd, true);
+	}
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+/// The ultimate gain and period follow from the limit cycle: the period is only resolved to a timestep, and the
+/// amplitude is sampled.
+void test_limitCycle() {
+	const double d = 0.25, eps = 0.5, bias = 0.5;
+	Plant plant(bias);
+	RelayAutotuner autotuner;
+	autotuner.start(50, bias, d, eps, Plant::dt, 4, 1800);
+
+	for (uint32_t i = 0; i < 100000 && autotuner.isRunning(); i++)
+		plant.step(autotuner.step(plant.y));
+	TEST_ASSERT_TRUE(autotuner.getState() == RelayAutotuner::State::done);
+
+	// Recover Ku and Tu from the Tyreus–Luyben gains
+	double Kp, Ki, Kd;
+	autotuner.getGains(Kp, Ki, Kd, true);
+	double Ku = 2.2 * Kp;
+	double Tu = Kp / (2.2 * Ki);
+
+	double KuRelay, TuRelay;
+	relayLimitCycle(plant.K, plant.tau, Plant::L, d, eps, KuRelay, TuRelay);
+	double KuActual, TuActual;
+	phaseCrossover(plant.K, plant.tau, Plant::L, KuActual, TuActual);
+
+	char msg[120];
+	snprintf(msg, sizeof(msg), "Ku %.4f (limit cycle %.4f, actual %.4f), "
+	                           "Tu %.2f s (limit cycle %.2f s, actual %.2f s)",
+	         Ku, KuRelay, KuActual, Tu, TuRelay, TuActual);
+	TEST_MESSAGE(msg);
+
+	TEST_ASSERT_DOUBLE_WITHIN(0.02 * KuRelay, KuRelay, Ku);
+	TEST_ASSERT_DOUBLE_WITHIN(2 * Plant::dt / 1000., TuRelay, Tu);
+
+	// The describing function neglects the harmonics of the relay output, so the estimate deviates from the actual
+	// ultimate point; with a small dead time and hysteresis, it underestimates Ku and overestimates Tu
+	TEST_ASSERT_DOUBLE_WITHIN(0.3 * KuActual, KuActual, Ku);
+	TEST_ASSERT_DOUBLE_WITHIN(0.15 * TuActual, TuActual, Tu);
+
+	// PI gains
+	double KpPI, KiPI, KdPI;
+	autotuner.getGains(KpPI, KiPI, KdPI, false);
+	TEST_ASSERT_DOUBLE_WITHIN(1e-12, Ku / 3.2, KpPI);
+	TEST_ASSERT_DOUBLE_WITHIN(1e-12, KpPI / (2.2 * Tu), KiPI);
+	TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0, KdPI);
+}
+
+/// Without a response of the plant, the relay never switches back, and the experiment fails after the timeout.
+void test_timeout() {
+	RelayAutotuner autotuner;
+	autotuner.start(50, 0.5, 0.25, 0.5, Plant::dt, 4, 10);
+
+	const uint32_t maxSteps = 10 * 1000 / Plant::dt;
+	for (uint32_t i = 0; i < maxSteps; i++)
+		TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0.75, autotuner.step(40));
+	TEST_ASSERT_TRUE(autotuner.isRunning());
+
+	// The relay output returns to the bias
+	TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0.5, autotuner.step(40));
+	TEST_ASSERT_TRUE(autotuner.getState() == RelayAutotuner::State::failed);
+	TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0.5, autotuner.step(40));
+
+	autotuner.reset();
+	TEST_ASSERT_TRUE(autotuner.getState() == RelayAutotuner::State::idle);
+}
+
+/// The Tyreus–Luyben gains are written into the ConfigStore once the experiment is done.
+void test_configStore() {
+	ConfigStore cs = defaultConfigStore;
+	TestController controller(&cs);
+	Plant plant(0.5);
+
+	controller.start();
+	TEST_ASSERT_TRUE(controller.isTuning());
+	TEST_ASSERT_TRUE(controller.finish() == RelayAutotuner::State::idle);
+
+	uint32_t i = 0;
+	while (controller.step(plant) && i++ < 100000) {}
+	TEST_ASSERT_TRUE(controller.finish() == RelayAutotuner::State::done);
+	TEST_ASSERT_FALSE(controller.isTuning());
+
+	double Ku, Tu;
+	relayLimitCycle(plant.K, plant.tau, Plant::L, config::AT_amplitude, config::HC_AT_hysteresis, Ku, Tu);
+	TEST_ASSERT_DOUBLE_WITHIN(0.02 * Ku / 2.2, Ku / 2.2, cs.HC_Kp);
+	TEST_ASSERT_DOUBLE_WITHIN(0.03 * Ku / 2.2 / (2.2 * Tu), Ku / 2.2 / (2.2 * Tu), cs.HC_Ki);
+	TEST_ASSERT_DOUBLE_WITHIN(0.03 * Ku / 2.2 * Tu / 6.3, Ku / 2.2 * Tu / 6.3, cs.HC_Kd);
+	TEST_ASSERT_DOUBLE_WITHIN(1e-12, config::HC_Kf, cs.HC_Kf);
+
+	// The result has been processed: nothing more to write
+	TEST_ASSERT_TRUE(controller.finish() == RelayAutotuner::State::idle);
+}
+
+/// A failed experiment leaves the gains in the ConfigStore as they were.
+void test_configStoreFailed() {
+	ConfigStore cs = defaultConfigStore;
+	TestController controller(&cs);
+	Plant plant(0.5);
+	plant.K = 0;
+
+	// The tick after the last allowed step finds the timeout
+	controller.start();
+	uint32_t ticks = 0;
+	while (controller.step(plant))
+		ticks++;
+	TEST_ASSERT_EQUAL(static_cast<uint32_t>(config::AT_timeout) * 1000 / Plant::dt + 1, ticks);
+
+	TEST_ASSERT_TRUE(controller.finish() == RelayAutotuner::State::failed);
+	TEST_ASSERT_DOUBLE_WITHIN(1e-12, config::HC_Kp, cs.HC_Kp);
+	TEST_ASSERT_DOUBLE_WITHIN(1e-12, config::HC_Ki, cs.HC_Ki);
+	TEST_ASSERT_DOUBLE_WITHIN(1e-12, config::HC_Kd, cs.HC_Kd);
+	TEST_ASSERT_FALSE(controller.isTuning());
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_limitCycle);
+	RUN_TEST(test_timeout);
+	RUN_TEST(test_configStore);
+	RUN_TEST(test_configStoreFailed);
+	return UNITY_END();
+}
@@ -0,0 +1,70 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "sensor/FlowSensor.h"
+
+/// Accuracy of the flowrate table against the polynomial it is generated from.
+
+/// Resolution of the table entries (in L/min)
+constexpr double lsb = 1. / 65536;
+
+void setUp() {}
+
+void tearDown() {}
+
+/// Every ADC value hits a table entry, which is the polynomial rounded to the nearest q16_16 number.
+void test_entries() {
+	double maxError = 0;
+	for (uint16_t i = 0; i < FlowSensor::tableSize; i++) {
+		double expected = FlowSensor::polynomial(i);
+		double actual = static_cast<double>(FlowSensor::lookup(i << ADCScanner::extraBits));
+		maxError = fmax(maxError, fabs(actual - expected));
+		TEST_ASSERT_DOUBLE_WITHIN(lsb / 2, expected, actual);
+	}
+
+	char msg[80];
+	snprintf(msg, sizeof(msg), "max error at the entries: %.2f LSB", maxError / lsb);
+	TEST_MESSAGE(msg);
+}
+
+/// Between the entries, the extra bits of the oversampled value interpolate linearly: the error is that of the linear
+/// interpolation of the polynomial, plus the rounding of the entries and of the product.
+void test_interpolation() {
+	constexpr uint16_t steps = 1 << ADCScanner::extraBits;
+	double maxError = 0;
+	for (uint16_t i = 0; i < FlowSensor::tableSize - 1; i++) {
+		// The curvature of the polynomial is nearly constant over a segment, so the interpolation error is largest in
+		// its middle
+		double chordError = fabs((FlowSensor::polynomial(i) + FlowSensor::polynomial(i + 1)) / 2 -
+		                         FlowSensor::polynomial(i + 0.5));
+		double bound = 1.1 * chordError + 2 * lsb;
+
+		for (uint16_t j = 1; j < steps; j++) {
+			double expected = FlowSensor::polynomial(i + static_cast<double>(j) / steps);
+			double actual = static_cast<double>(FlowSensor::lookup((i << ADCScanner::extraBits) + j));
+			maxError = fmax(maxError, fabs(actual - expected));
+			TEST_ASSERT_DOUBLE_WITHIN(bound, expected, actual);
+		}
+	}
+
+	char msg[80];
+	snprintf(msg, sizeof(msg), "max error between the entries: %.2f LSB", maxError / lsb);
+	TEST_MESSAGE(msg);
+}
+
+/// Values at or beyond the last entry saturate to it.
+void test_saturation() {
+	double last = FlowSensor::polynomial(FlowSensor::tableSize - 1);
+	uint16_t value = (FlowSensor::tableSize - 1) << ADCScanner::extraBits;
+	TEST_ASSERT_DOUBLE_WITHIN(lsb / 2, last, static_cast<double>(FlowSensor::lookup(value)));
+	TEST_ASSERT_DOUBLE_WITHIN(lsb / 2, last, static_cast<double>(FlowSensor::lookup(value + 1)));
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_entries);
+	RUN_TEST(test_interpolation);
+	RUN_TEST(test_saturation);
+	return UNITY_END();
+}
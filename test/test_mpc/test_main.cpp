@@ -0,0 +1,88 @@
+#include <unity.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+#include "control/MPC.h"
+
+/// Worst-case runtime of a step of the model predictive controller, and its closed loop on the mixing model.
+
+/// MPC at the full horizon and history, as used by the cascade humidistat with mpc enabled
+using FullMPC = MPC<config::MPC_horizon, config::MPC_maxDelay>;
+
+/// Mixing model of the chamber (as in the MPC), with a transport delay of MPC_maxDelay steps.
+struct Chamber {
+	double x = 40; //!< Humidity (RH, in percent)
+
+	double flows[config::MPC_maxDelay][2]{}; //!< Flowrates in transit (wet, dry)
+	uint8_t head = 0;
+
+	/// Advance the model by one step of the MPC.
+	/// \param wetFlow Flowrate of the wet line (L/min)
+	/// \param dryFlow Flowrate of the dry line (L/min)
+	void step(double wetFlow, double dryFlow) {
+		double *u = flows[head];
+		double dt = config::MPC_dt / 1000.;
+		x += (u[0] * (config::KF_wetHumidity - x) + u[1] * (config::KF_dryHumidity - x)) /
+		     (config::KF_chamberVolume * 60) * dt;
+		u[0] = wetFlow;
+		u[1] = dryFlow;
+		head = (head + 1) % config::MPC_maxDelay;
+	}
+};
+
+FullMPC mpc;
+
+void setUp() {}
+
+void tearDown() {}
+
+/// Time the steps of the MPC in closed loop, with the longest delay. The number of iterations is fixed, so every step
+/// does the same work; report the worst case.
+void test_worstCase() {
+	const double total = config::HC_totalFlowrate;
+	Chamber chamber;
+	mpc.setDelay(1e6);
+	mpc.reset(total / 2, total / 2);
+	for (auto &u : chamber.flows)
+		u[0] = u[1] = total / 2;
+
+	double wetFlow = total / 2, dryFlow = total / 2;
+	double maxTime = 0, sumTime = 0;
+	const uint16_t nSteps = 600;
+	for (uint16_t i = 0; i < nSteps; i++) {
+		double sp = i < 300 ? 70 : 30;
+
+		auto start = std::chrono::steady_clock::now();
+		mpc.step(chamber.x, sp, wetFlow, dryFlow, total, wetFlow, dryFlow);
+		auto end = std::chrono::steady_clock::now();
+		double time = std::chrono::duration<double, std::micro>(end - start).count();
+		sumTime += time;
+		if (time > maxTime)
+			maxTime = time;
+
+		TEST_ASSERT_TRUE(wetFlow >= 0 && wetFlow <= total);
+		TEST_ASSERT_TRUE(dryFlow >= 0 && dryFlow <= total);
+		chamber.step(wetFlow, dryFlow);
+
+		// The setpoint is reached before it changes
+		if (i == 299)
+			TEST_ASSERT_DOUBLE_WITHIN(1, 70, chamber.x);
+	}
+	TEST_ASSERT_DOUBLE_WITHIN(1, 30, chamber.x);
+
+	// Multiply-adds of the solver: a product of the Hessian with a vector per iteration
+	const uint32_t n = 2 * config::MPC_horizon;
+	char msg[160];
+	snprintf(msg, sizeof(msg), "horizon %u, delay %u, %u iterations (%lu multiply-adds in the solver): "
+	                           "step on the host: max %.1f us, mean %.1f us",
+	         config::MPC_horizon, config::MPC_maxDelay, config::MPC_iterations,
+	         static_cast<unsigned long>(n * n * config::MPC_iterations), maxTime, sumTime / nSteps);
+	TEST_MESSAGE(msg);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_worstCase);
+	return UNITY_END();
+}
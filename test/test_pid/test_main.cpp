@@ -0,0 +1,186 @@
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+
+#include "control/PID.h"
+
+/// Equivalence of the fixed-point PID with the floating-point one, on a simulated humidity chamber.
+
+/// First-order model of the chamber: the humidity approaches K * cv with time constant tau.
+struct Plant {
+	double K = 100;  //!< Gain (in percentage points per unit of cv)
+	double tau = 30; //!< Time constant (in s)
+	double y = 40;   //!< Humidity (in percent)
+
+	/// Advance the model by one timestep.
+	/// \param u  Control variable
+	/// \param dt Timestep (in s)
+	void step(double u, double dt) {
+		y += (K * u - y) * dt / tau;
+	}
+};
+
+/// Closed loop of a PID (with the given arithmetic) and a plant.
+template<typename Scalar>
+struct Loop {
+	static constexpr uint16_t dt = 250; //!< Timestep (in ms)
+
+	Plant plant;
+	double pv = 40, sp = 50, cv = 0.5;
+	PID<Scalar> pid;
+
+	explicit Loop(uint8_t filterOrder)
+		: pid(&pv, &cv, &sp, 0.05, 0.005, 0.05, 0.005, dt, 0, 1, 0.5, filterOrder) {}
+
+	/// Run a cycle of the PID, and advance the plant.
+	void step() {
+		pv = plant.y;
+		pid.compute();
+		plant.step(cv, dt / 1000.);
+	}
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+/// The run-time conversions give the same underlying integer as the constructor, and the same double as the
+/// conversion operator.
+void test_conversion() {
+	const double values[] = {0, 1, -1, 0.5, -0.5, 1.5 / 65536, -2.5 / 65536, 0.4 / 65536, 1e-30, 3.14159265, -2.71828,
+	                         12345.678, -32767.99, 32767.99999, 32768, -32768, -32769, 1e6, -1e6};
+	for (double x : values) {
+		TEST_ASSERT_EQUAL_INT32(q16_16(x).getRaw(), q16_16::fromFloat(x).getRaw());
+		TEST_ASSERT_EQUAL_INT32(q16_16(static_cast<double>(static_cast<float>(x))).getRaw(),
+		                        q16_16::fromFloat(static_cast<float>(x)).getRaw());
+	}
+	TEST_ASSERT_EQUAL_INT32(0, q16_16::fromFloat(NAN).getRaw());
+	TEST_ASSERT_EQUAL_INT32(INT32_MAX, q16_16::fromFloat(INFINITY).getRaw());
+	TEST_ASSERT_EQUAL_INT32(INT32_MIN, q16_16::fromFloat(-INFINITY).getRaw());
+
+	// Pseudo-random values over the range of both formats
+	uint32_t state = 1;
+	for (uint16_t i = 0; i < 10000; i++) {
+		state = state * 1664525 + 1013904223;
+		double x = (static_cast<int32_t>(state) / 2147483648.) * 40000;
+		TEST_ASSERT_EQUAL_INT32(q16_16(x).getRaw(), q16_16::fromFloat(x).getRaw());
+		TEST_ASSERT_EQUAL_INT32(q8_24(x / 300).getRaw(), q8_24::fromFloat(x / 300).getRaw());
+
+		q16_16 f = q16_16::fromRaw(static_cast<int32_t>(state));
+		TEST_ASSERT_TRUE(static_cast<double>(f) == f.toFloat<double>());
+		TEST_ASSERT_TRUE(static_cast<float>(static_cast<double>(f)) == f.toFloat<float>());
+	}
+}
+
+/// Run both PIDs through a sequence of setpoint steps (into saturation), a manual period with a bumpless transfer,
+/// feed-forward, and back-calculation, and compare their outputs.
+/// \param filterOrder Order of the derivative filter
+/// \param Tt          Tracking time constant (in s)
+void compare(uint8_t filterOrder, double Tt) {
+	Loop<double> ref(filterOrder);
+	Loop<q16_16> fixed(filterOrder);
+	ref.pid.setTrackingTime(Tt);
+	fixed.pid.setTrackingTime(Tt);
+	ref.pid.setAuto(true);
+	fixed.pid.setAuto(true);
+
+	double maxDiff = 0;
+	for (uint16_t i = 0; i < 4000; i++) {
+		double sp = i < 1000 ? 50 : i < 2000 ? 95 : i < 3000 ? 20 : 60;
+		ref.sp = fixed.sp = sp;
+
+		// Manual with a fixed cv for a while, then back to auto
+		bool inAuto = i < 2500 || i >= 2700;
+		ref.pid.setAuto(inAuto);
+		fixed.pid.setAuto(inAuto);
+		if (!inAuto)
+			ref.cv = fixed.cv = 0.3;
+
+		double ff = i >= 3000 ? 0.1 : 0;
+		ref.pid.setFeedForward(ff);
+		fixed.pid.setFeedForward(ff);
+
+		ref.step();
+		fixed.step();
+
+		double diff = fabs(ref.cv - fixed.cv);
+		if (diff > maxDiff)
+			maxDiff = diff;
+	}
+
+	char msg[80];
+	snprintf(msg, sizeof(msg), "order %u, Tt %g: max cv difference %.2e", filterOrder, Tt, maxDiff);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_LESS_THAN_DOUBLE(1e-4, maxDiff);
+	TEST_ASSERT_DOUBLE_WITHIN(0.01, ref.plant.y, fixed.plant.y);
+	TEST_ASSERT_DOUBLE_WITHIN(0.5, 60, fixed.plant.y);
+}
+
+void test_equivalence_conditional() {
+	compare(1, 0);
+}
+
+void test_equivalence_backCalculation() {
+	compare(1, 10);
+}
+
+void test_equivalence_secondOrderFilter() {
+	compare(2, 10);
+}
+
+/// With the feed-forward on the setpoint disabled, only the external feed-forward is added, so that the two do not
+/// count the steady-state output twice.
+template<typename Scalar>
+void checkSetpointFeedForward() {
+	double pv = 50, sp = 50, cv = 0;
+	PID<Scalar> pid(&pv, &cv, &sp, 0, 0, 0, 0.01, 250, 0, 1, 0, 1);
+	pid.setAuto(true);
+	pid.setFeedForward(0.2);
+
+	pid.compute();
+	TEST_ASSERT_DOUBLE_WITHIN(1e-4, 0.7, cv);
+
+	pid.setSetpointFeedForward(false);
+	pid.compute();
+	TEST_ASSERT_DOUBLE_WITHIN(1e-4, 0.2, cv);
+}
+
+void test_setpointFeedForward() {
+	checkSetpointFeedForward<double>();
+	checkSetpointFeedForward<q16_16>();
+}
+
+/// Time a PID cycle on the host, for both types. This only compares the arithmetic on a CPU with an FPU; on the MCU,
+/// compare the tick statistics (see the README) of builds with and without HUMIDISTAT_PID_FIXED.
+template<typename Scalar>
+double timeCompute() {
+	constexpr uint32_t n = 1000000;
+	Loop<Scalar> loop(1);
+	loop.pid.setAuto(true);
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < n; i++) {
+		loop.pv = 50 + (i % 16) * 0.01;
+		loop.pid.compute();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / n;
+}
+
+void test_timing() {
+	char msg[80];
+	snprintf(msg, sizeof(msg), "compute() on the host: double %.1f ns, q16_16 %.1f ns", timeCompute<double>(),
+	         timeCompute<q16_16>());
+	TEST_MESSAGE(msg);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_conversion);
+	RUN_TEST(test_equivalence_conditional);
+	RUN_TEST(test_equivalence_backCalculation);
+	RUN_TEST(test_equivalence_secondOrderFilter);
+	RUN_TEST(test_setpointFeedForward);
+	RUN_TEST(test_timing);
+	return UNITY_END();
+}
@@ -0,0 +1,116 @@
+#include <unity.h>
+#include <math.h>
+
+#include "control/SensorFilter.h"
+
+/// Outlier rejection, rate limiting and missing-sample handling of the sensor pre-filter.
+
+/// Feed a sequence of samples into a filter, 1 s apart.
+/// \param filter  Filter
+/// \param samples Samples
+/// \param n       Number of samples
+template<uint8_t N>
+void feed(SensorFilter<N> &filter, const double *samples, uint8_t n) {
+	for (uint8_t i = 0; i < n; i++)
+		TEST_ASSERT_TRUE(filter.update(samples[i], 1000));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+/// A single spike is replaced by the median of the window.
+void test_spike() {
+	SensorFilter<5> filter(3, 0.1, 0, 0);
+	const double samples[] = {50, 50.1, 49.9, 50, 50.1};
+	feed(filter, samples, 5);
+	TEST_ASSERT_DOUBLE_WITHIN(1e-9, 50.1, filter.getValue());
+
+	// Window {50.1, 49.9, 50, 50.1, 80}: median 50.1
+	TEST_ASSERT_TRUE(filter.update(80, 1000));
+	TEST_ASSERT_DOUBLE_WITHIN(1e-9, 50.1, filter.getValue());
+	TEST_ASSERT_EQUAL(1, filter.getRejected());
+}
+
+/// With quantised samples, the window often reads a single value, so that the MAD is 0: a change of a single step is
+/// only accepted thanks to the floor at the resolution.
+void test_quantisedStep() {
+	const double samples[] = {50, 50, 50, 50};
+
+	SensorFilter<5> filter(3, 0.1, 0, 0);
+	feed(filter, samples, 4);
+	TEST_ASSERT_TRUE(filter.update(50.1, 1000));
+	TEST_ASSERT_DOUBLE_WITHIN(1e-9, 50.1, filter.getValue());
+	TEST_ASSERT_EQUAL(0, filter.getRejected());
+
+	// Without the floor, it counts as an outlier
+	SensorFilter<5> unfloored(3, 0, 0, 0);
+	feed(unfloored, samples, 4);
+	TEST_ASSERT_TRUE(unfloored.update(50.1, 1000));
+	TEST_ASSERT_DOUBLE_WITHIN(1e-9, 50, unfloored.getValue());
+	TEST_ASSERT_EQUAL(1, unfloored.getRejected());
+}
+
+/// A true step passes once it holds the majority of the window: after a delay of N/2 samples.
+void test_stepDelay() {
+	SensorFilter<5> filter(3, 0.1, 0, 0);
+	const double samples[] = {50, 50, 50, 50, 50};
+	feed(filter, samples, 5);
+
+	const double expected[] = {50, 50, 60, 60};
+	for (double x : expected) {
+		TEST_ASSERT_TRUE(filter.update(60, 1000));
+		TEST_ASSERT_DOUBLE_WITHIN(1e-9, x, filter.getValue());
+	}
+}
+
+/// The output moves towards the sample by at most maxRate per second.
+void test_rateLimit() {
+	SensorFilter<1> filter(3, 0.1, 2, 0);
+	TEST_ASSERT_TRUE(filter.update(50, 1000));
+	TEST_ASSERT_DOUBLE_WITHIN(1e-9, 50, filter.getValue());
+
+	TEST_ASSERT_TRUE(filter.update(60, 1000));
+	TEST_ASSERT_DOUBLE_WITHIN(1e-9, 52, filter.getValue());
+	TEST_ASSERT_TRUE(filter.update(60, 500));
+	TEST_ASSERT_DOUBLE_WITHIN(1e-9, 53, filter.getValue());
+	TEST_ASSERT_TRUE(filter.update(40, 1000));
+	TEST_ASSERT_DOUBLE_WITHIN(1e-9, 51, filter.getValue());
+}
+
+/// Missing samples hold the output and are counted up to the stale limit; the first sample after the outage starts
+/// afresh, without the median of (or the rate limit from) the outdated window.
+void test_stale() {
+	SensorFilter<5> filter(3, 0.1, 1, 3);
+	const double samples[] = {50, 50, 50, 50, 50};
+	feed(filter, samples, 5);
+
+	for (uint8_t i = 0; i < 3; i++) {
+		TEST_ASSERT_FALSE(filter.isStale());
+		TEST_ASSERT_FALSE(filter.update(NAN, 1000));
+		TEST_ASSERT_DOUBLE_WITHIN(1e-9, 50, filter.getValue());
+	}
+	TEST_ASSERT_TRUE(filter.isStale());
+
+	TEST_ASSERT_TRUE(filter.update(70, 1000));
+	TEST_ASSERT_FALSE(filter.isStale());
+	TEST_ASSERT_DOUBLE_WITHIN(1e-9, 70, filter.getValue());
+	TEST_ASSERT_EQUAL(0, filter.getRejected());
+
+	// A shorter gap does not reset the filter
+	TEST_ASSERT_FALSE(filter.update(NAN, 1000));
+	TEST_ASSERT_TRUE(filter.update(71, 1000));
+	TEST_ASSERT_DOUBLE_WITHIN(1e-9, 71, filter.getValue());
+	TEST_ASSERT_TRUE(filter.update(72.5, 1000));
+	TEST_ASSERT_DOUBLE_WITHIN(1e-9, 72, filter.getValue());
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_spike);
+	RUN_TEST(test_quantisedStep);
+	RUN_TEST(test_stepDelay);
+	RUN_TEST(test_rateLimit);
+	RUN_TEST(test_stale);
+	return UNITY_END();
+}
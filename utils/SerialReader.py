@@ -53,6 +53,10 @@ class SerialReader:
 		line = self.serial.readline()
 		print(line)
 
+		# Lines starting with '#' (e.g. timing statistics) are not part of the data
+		if line.startswith(b'#'):
+			return np.array([])
+
 		return np.array(line.decode().split(), dtype=float)
 
 	def available(self) -> bool:
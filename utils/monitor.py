@@ -60,6 +60,10 @@ ax_dist = {
 	'inner1pTerm': 6,
 	'inner1iTerm': 6,
 	'inner1dTerm': 6,
+	'PVest': 0,
+	'innov': 1,
+	'NIS': 1,
+	'SPramp': 0,
 }
 
 mosaic = '''
@@ -85,8 +89,8 @@ with SerialReader(args.port, args.baud) as sr:
 	# Data is column-major: inner lists are appended to for every line of data received
 	data = [[] for column in sr.header]
 
-	# Setup empty plot
-	lines = [axs[ax_dist[column]].plot([], label=column)[0] for column in sr.header[1:]]
+	# Setup empty plot (with multiple channels, column names are suffixed by '_' and the channel index)
+	lines = [axs[ax_dist[column.split('_')[0]]].plot([], label=column)[0] for column in sr.header[1:]]
 
 	for ax in axs:
 		ax.legend()